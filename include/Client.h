@@ -56,14 +56,23 @@ public:
     ~TClient();
     TClient& operator=(const TClient&) = delete;
 
-    void AddNewCar(int Ident, const std::string& Data);
-    void SetCarData(int Ident, const std::string& Data);
+    void AddNewCar(int Ident, std::string Data, bool IsUnicycle = false);
+    void SetCarData(int Ident, std::string Data);
+    enum class EditResult {
+        Applied,
+        NoSuchVehicle,
+        // the edit or the stored config couldn't be parsed, nothing changed
+        Invalid,
+    };
+    // Merges an edit into the stored config.
+    EditResult ApplyCarEdit(int Ident, std::string_view Patch);
+    [[nodiscard]] bool IsCarUnicycle(int Ident) const;
     void SetCarPosition(int Ident, const std::string& Data);
     TVehicleDataLockPair GetAllCars();
     void SetName(const std::string& Name) { mName = Name; }
     void SetRoles(const std::string& Role) { mRole = Role; }
     void SetIdentifier(const std::string& key, const std::string& value) { mIdentifiers[key] = value; }
-    std::string GetCarData(int Ident);
+    std::shared_ptr<const std::string> GetCarData(int Ident);
     std::string GetCarPositionRaw(int Ident);
     void SetUDPAddr(const ip::udp::endpoint& Addr) { mUDPAddress = Addr; }
     void SetTCPSock(ip::tcp::socket&& CSock) { mSocket = std::move(CSock); }
@@ -82,6 +91,13 @@ public:
     void SetID(int ID) { mID = ID; }
     [[nodiscard]] int GetOpenCarID() const;
     [[nodiscard]] int GetCarCount() const;
+    struct TCarsMemoryUsage {
+        size_t Bytes { 0 };
+        // includes the unicycle, unlike GetCarCount()
+        size_t Configs { 0 };
+    };
+    // Approximate bytes used by the stored configs of all of this client's vehicles.
+    [[nodiscard]] TCarsMemoryUsage GetCarsMemoryUsage() const;
     void ClearCars();
     [[nodiscard]] int GetID() const { return mID; }
     [[nodiscard]] int GetUnicycleID() const { return mUnicycleID; }
@@ -21,6 +21,8 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <deque>
 #include <filesystem>
@@ -31,6 +33,7 @@
 #include <shared_mutex>
 #include <span>
 #include <sstream>
+#include <stop_token>
 #include <unordered_map>
 #include <zlib.h>
 
@@ -92,8 +95,25 @@ public:
     static std::array<uint8_t, 3> VersionStrToInts(const std::string& str);
     static bool IsOutdated(const Version& Current, const Version& Newest);
     static bool IsShuttingDown();
+    // Blocks until the server shuts down.
+    static void WaitForShutdown();
+    // Sleeps for `Timeout`, but returns early when the server shuts down.
+    // Returns whether the server is shutting down.
+    static bool SleepUntilShutdown(std::chrono::steady_clock::duration Timeout);
+    // Stop is requested when the server shuts down, for waiting on a
+    // std::condition_variable_any until either the condition or shutdown.
+    static std::stop_token ShutdownToken() { return mShutdownSource.get_token(); }
     static void SleepSafeSeconds(size_t Seconds);
 
+    // Bumped whenever something that is shown in the server list changes
+    // (players, settings, mods), so the heartbeat can wait for it instead of
+    // polling.
+    static uint64_t PublicStateVersion();
+    static void NotifyPublicStateChanged();
+    // Returns when the version is no longer `Seen`, after `Timeout`, or when the
+    // server shuts down, whichever comes first.
+    static void WaitForPublicStateChange(uint64_t Seen, std::chrono::steady_clock::duration Timeout);
+
     static void InitializeConsole() {
         mConsole.InitializeCommandline();
     }
@@ -122,10 +142,16 @@ private:
     static inline std::mutex mSystemStatusMapMutex {};
     static inline std::string mPPS;
     static inline TConsole mConsole;
-    static inline std::shared_mutex mShutdownMtx {};
-    static inline bool mShutdown { false };
+    static inline std::atomic<bool> mShutdown { false };
+    // for WaitForShutdown() and SleepUntilShutdown(), IsShuttingDown() doesn't lock
+    static inline std::mutex mShutdownWaitMutex {};
+    static inline std::condition_variable mShutdownWaitCondition {};
+    static inline std::stop_source mShutdownSource {};
     static inline std::mutex mShutdownHandlersMutex {};
     static inline std::deque<TShutdownHandler> mShutdownHandlers {};
+    static inline std::mutex mPublicStateMutex {};
+    static inline std::condition_variable mPublicStateCondition {};
+    static inline uint64_t mPublicStateVersion { 0 };
 
     static inline Version mVersion { 3, 6, 0 };
 };
@@ -141,7 +167,18 @@ void RegisterThread(const std::string& str);
 #define GB (MB * 1024llu)
 #define SSU_UNRAW SECRET_SENTRY_URL
 
-#define _file_basename std::filesystem::path(__FILE__).filename().string()
+// the part of `Path` after the last path separator, without allocating
+constexpr const char* FileBasename(const char* Path) {
+    const char* Base = Path;
+    for (const char* It = Path; *It != '\0'; ++It) {
+        if (*It == '/' || *It == '\\') {
+            Base = It + 1;
+        }
+    }
+    return Base;
+}
+
+#define _file_basename std::string(FileBasename(__FILE__))
 #define _line std::to_string(__LINE__)
 #define _in_lambda (std::string(__func__) == "operator()")
 
@@ -167,6 +204,26 @@ void RegisterThread(const std::string& str);
         #define DEBUG
     #endif
 
+    // Log messages below BEAMMP_LOG_LEVEL are compiled out, together with their
+    // arguments. Pass e.g. -DBEAMMP_LOG_LEVEL=BEAMMP_LOG_LEVEL_INFO to strip
+    // debug and trace logging from a build. Debug and trace messages which are
+    // compiled in are still only printed with General.Debug on, and their
+    // arguments are only evaluated then.
+    #define BEAMMP_LOG_LEVEL_TRACE 0
+    #define BEAMMP_LOG_LEVEL_DEBUG 1
+    #define BEAMMP_LOG_LEVEL_INFO 2
+    #define BEAMMP_LOG_LEVEL_WARN 3
+    #define BEAMMP_LOG_LEVEL_ERROR 4
+
+    #ifndef BEAMMP_LOG_LEVEL
+        #if defined(DEBUG)
+            #define BEAMMP_LOG_LEVEL BEAMMP_LOG_LEVEL_TRACE
+        #else
+            // trace() is a debug-build debug()
+            #define BEAMMP_LOG_LEVEL BEAMMP_LOG_LEVEL_DEBUG
+        #endif
+    #endif
+
     #if defined(DEBUG)
 
         // if this is defined, we will show the full function signature infront of
@@ -179,8 +236,16 @@ void RegisterThread(const std::string& str);
 
     #endif // defined(DEBUG)
 
-    #define beammp_warn(x) Application::Console().Write(_this_location + std::string("[WARN] ") + (x))
-    #define beammp_info(x) Application::Console().Write(_this_location + std::string("[INFO] ") + (x))
+    #if BEAMMP_LOG_LEVEL <= BEAMMP_LOG_LEVEL_WARN
+        #define beammp_warn(x) Application::Console().Write(_this_location + std::string("[WARN] ") + (x))
+    #else
+        #define beammp_warn(x)
+    #endif
+    #if BEAMMP_LOG_LEVEL <= BEAMMP_LOG_LEVEL_INFO
+        #define beammp_info(x) Application::Console().Write(_this_location + std::string("[INFO] ") + (x))
+    #else
+        #define beammp_info(x)
+    #endif
     #define beammp_error(x)                                                               \
         do {                                                                              \
             Application::Console().Write(_this_location + std::string("[ERROR] ") + (x)); \
@@ -198,20 +263,24 @@ void RegisterThread(const std::string& str);
             Application::Console().Write(_this_location + std::string("[LUA WARN] ") + (x)); \
         } while (false)
     #define luaprint(x) Application::Console().Write(_this_location + std::string("[LUA] ") + (x))
-    #define beammp_debug(x)                                                                   \
-        do {                                                                                  \
-            if (Application::Settings.getAsBool(Settings::Key::General_Debug)) {                                     \
-                Application::Console().Write(_this_location + std::string("[DEBUG] ") + (x)); \
-            }                                                                                 \
-        } while (false)
-    #define beammp_event(x)                                                                   \
-        do {                                                                                  \
-            if (Application::Settings.getAsBool(Settings::Key::General_Debug)) {                                     \
-                Application::Console().Write(_this_location + std::string("[EVENT] ") + (x)); \
-            }                                                                                 \
-        } while (false)
-    // trace() is a debug-build debug()
-    #if defined(DEBUG)
+    #if BEAMMP_LOG_LEVEL <= BEAMMP_LOG_LEVEL_DEBUG
+        #define beammp_debug(x)                                                                   \
+            do {                                                                                  \
+                if (Application::Settings.getAsBool(Settings::Key::General_Debug)) {                                     \
+                    Application::Console().Write(_this_location + std::string("[DEBUG] ") + (x)); \
+                }                                                                                 \
+            } while (false)
+        #define beammp_event(x)                                                                   \
+            do {                                                                                  \
+                if (Application::Settings.getAsBool(Settings::Key::General_Debug)) {                                     \
+                    Application::Console().Write(_this_location + std::string("[EVENT] ") + (x)); \
+                }                                                                                 \
+            } while (false)
+    #else
+        #define beammp_debug(x)
+        #define beammp_event(x)
+    #endif
+    #if BEAMMP_LOG_LEVEL <= BEAMMP_LOG_LEVEL_TRACE
         #define beammp_trace(x)                                                                   \
             do {                                                                                  \
                 if (Application::Settings.getAsBool(Settings::Key::General_Debug)) {                                     \
@@ -220,8 +289,10 @@ void RegisterThread(const std::string& str);
             } while (false)
     #else
         #define beammp_trace(x)
-    #endif // defined(DEBUG)
+    #endif
 
+    // the format call is part of the macro argument, so it only runs if the
+    // message is compiled in and enabled
     #define beammp_errorf(...) beammp_error(fmt::format(__VA_ARGS__))
     #define beammp_infof(...) beammp_info(fmt::format(__VA_ARGS__))
     #define beammp_debugf(...) beammp_debug(fmt::format(__VA_ARGS__))
@@ -40,6 +40,16 @@ namespace fs = std::filesystem;
 namespace Http {
 std::string GET(const std::string& host, int port, const std::string& target, unsigned int* status = nullptr);
 std::string POST(const std::string& host, int port, const std::string& target, const std::string& body, const std::string& ContentType, unsigned int* status = nullptr, const httplib::Headers& headers = {});
+
+struct Response {
+    // 0 if the request failed before a response was received
+    int Status { 0 };
+    std::string Body;
+};
+// POSTs on the calling thread. Connections are kept alive and shared between
+// all requests to the same origin (e.g. "https://auth.beammp.com:443"), so
+// that repeated requests skip the TCP and TLS handshakes.
+Response POSTToOrigin(const std::string& Origin, const std::string& target, const std::string& body, const std::string& ContentType, const httplib::Headers& headers = {});
 namespace Status {
     std::string ToString(int code);
 }
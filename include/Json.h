@@ -18,6 +18,8 @@
 
 #pragma once
 #include "rapidjson/document.h"
+#include "rapidjson/memorystream.h"
 #include "rapidjson/prettywriter.h"
+#include "rapidjson/reader.h"
 #include "rapidjson/stringbuffer.h"
 #include "rapidjson/writer.h"
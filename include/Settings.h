@@ -18,15 +18,21 @@
 
 #pragma once
 #include "Sync.h"
+#include <array>
+#include <atomic>
 #include <concepts>
 #include <cstdint>
 #include <doctest/doctest.h>
 #include <fmt/core.h>
 #include <fmt/format.h>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 struct ComposedKey {
     std::string Category;
@@ -72,6 +78,16 @@ struct Settings {
         Misc_SendErrors,
         Misc_ImScaredOfUpdates,
         Misc_UpdateReminderTime,
+        Misc_CompactVehicleConfigs,
+        Misc_MaxConcurrentAuths,
+        Misc_MaxConcurrentResourceSyncs,
+        Misc_MaxConcurrentWorldSyncs,
+        Misc_AuthCacheSeconds,
+        Misc_LogSyncIntervalSeconds,
+        Misc_LogRotateSizeMB,
+        Misc_LogRotateHours,
+        Misc_LogArchivesKept,
+        Misc_EventJournalRecords,
 
         // [General]
         General_Description,
@@ -86,9 +102,30 @@ struct Settings {
         General_LogChat,
         General_ResourceFolder,
         General_Debug,
-        General_AllowGuests
+        General_AllowGuests,
+
+        // not a setting, the number of keys; must stay last
+        KeyCount
+    };
+
+    // All settings at one point in time. Never modified once published, every
+    // change publishes a new one, so readers don't need a lock.
+    struct Snapshot {
+        std::array<std::optional<SettingsTypeVariant>, KeyCount> Values;
+
+        const SettingsTypeVariant& get(Key key) const {
+            if (!Values[key]) {
+                throw std::logic_error { "Undefined setting key accessed in Settings::Snapshot::get" };
+            }
+            return *Values[key];
+        }
+        const std::string& getAsString(Key key) const { return std::get<std::string>(get(key)); }
+        int getAsInt(Key key) const { return std::get<int>(get(key)); }
+        bool getAsBool(Key key) const { return std::get<bool>(get(key)); }
     };
 
+    // Source of truth for writers. Readers should use the getters, which read
+    // the current snapshot instead of locking this.
     Sync<std::unordered_map<Key, SettingsTypeVariant>> SettingsMap;
     enum SettingsAccessMask {
         READ_ONLY, // Value can be read from console
@@ -102,6 +139,12 @@ struct Settings {
         >;
 
     Sync<std::unordered_map<ComposedKey, SettingsAccessControl>> InputAccessMapping;
+    // The current snapshot. Hold on to it to read several settings which are
+    // consistent with each other. It stays valid for as long as this object.
+    const Snapshot& snapshot() const {
+        return *mSnapshot.load(std::memory_order_acquire);
+    }
+
     std::string getAsString(Key key);
 
     int getAsInt(Key key);
@@ -122,6 +165,7 @@ struct Settings {
             throw std::logic_error { fmt::format("Wrong value type in Settings::set(int): index {}", map->at(key).index()) };
         }
         map->at(key) = value;
+        publish(*map);
     }
     template <typename Boolean, std::enable_if_t<std::is_same_v<bool, Boolean>, bool> = true>
     void set(Key key, Boolean value) {
@@ -133,12 +177,35 @@ struct Settings {
             throw std::logic_error { fmt::format("Wrong value type in Settings::set(bool): index {}", map->at(key).index()) };
         }
         map->at(key) = value;
+        publish(*map);
     }
 
+    // Calls `listener` after every change to any setting, until the returned id
+    // is passed to removeChangeListener(). Listeners run on the thread which
+    // changed the setting, with the settings locked, so they must not change
+    // settings themselves.
+    size_t addChangeListener(std::function<void()> listener);
+    void removeChangeListener(size_t id);
+
     const std::unordered_map<ComposedKey, SettingsAccessControl> getAccessControlMap() const;
     SettingsAccessControl getConsoleInputAccessMapping(const ComposedKey& keyName);
 
     void setConsoleInputAccessMapping(const ComposedKey& keyName, const std::string& value);
     void setConsoleInputAccessMapping(const ComposedKey& keyName, int value);
     void setConsoleInputAccessMapping(const ComposedKey& keyName, bool value);
+
+private:
+    // Publishes a new snapshot of `map`, and lets the heartbeat know that the
+    // server's public info may have changed. Call with the map locked, so
+    // that snapshots are published in the order the changes were made.
+    void publish(const std::unordered_map<Key, SettingsTypeVariant>& map);
+    void storeSnapshot(const std::unordered_map<Key, SettingsTypeVariant>& map);
+
+    // a plain pointer, so that reading a setting is a single load
+    std::atomic<const Snapshot*> mSnapshot { nullptr };
+    // every snapshot ever published, as readers may still be using old ones;
+    // settings change rarely and snapshots are small. Guarded by SettingsMap.
+    std::vector<std::unique_ptr<const Snapshot>> mSnapshots;
+    Sync<std::unordered_map<size_t, std::function<void()>>> mChangeListeners;
+    std::atomic<size_t> mNextChangeListener { 0 };
 };
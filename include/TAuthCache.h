@@ -0,0 +1,77 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// What the authentication backend told us about a player.
+struct TAuthInfo {
+    std::string Name;
+    std::string Roles;
+    bool IsGuest { false };
+    // (type, value), e.g. ("beammp", "12345")
+    std::vector<std::pair<std::string, std::string>> Identifiers;
+};
+
+// Remembers authentication results for a short while, keyed by the player's
+// key and IP, so that a player who reconnects right after a crash doesn't need
+// another round trip to the backend. A TTL of 0 or less disables the cache.
+class TAuthCache {
+public:
+    struct TStats {
+        size_t Entries { 0 };
+        size_t Hits { 0 };
+        size_t Misses { 0 };
+    };
+
+    explicit TAuthCache(std::function<std::chrono::seconds()> TTL, size_t Capacity = 4096);
+
+    [[nodiscard]] std::optional<TAuthInfo> Find(const std::string& Key, const std::string& IP);
+    void Insert(const std::string& Key, const std::string& IP, TAuthInfo Info);
+    [[nodiscard]] TStats Stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct TEntry {
+        TAuthInfo Info;
+        Clock::time_point Expiry;
+        // insertion order, to evict the oldest entry first
+        uint64_t Sequence;
+    };
+
+    void EvictLocked(Clock::time_point Now);
+
+    std::function<std::chrono::seconds()> mTTL;
+    size_t mCapacity;
+    mutable std::mutex mMutex;
+    std::unordered_map<std::string, TEntry> mEntries;
+    size_t mHits { 0 };
+    size_t mMisses { 0 };
+    uint64_t mNextSequence { 0 };
+};
@@ -0,0 +1,139 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+// Recycles fixed-size memory blocks, for small objects which are created and
+// destroyed at a high rate, often on different threads.
+//
+// Every thread keeps its own cache of free blocks, so most allocations and
+// frees don't synchronize at all. Caches trade whole batches ("magazines") of
+// blocks with a shared depot, so that blocks freed on one thread can be
+// reused by another one. Whatever doesn't fit into the depot is freed.
+template <size_t Size, size_t Align>
+class TBlockPool {
+public:
+    static constexpr size_t MagazineSize = 64;
+    static constexpr size_t MaxDepotMagazines = 64;
+
+    static void* Allocate() {
+        auto& Cache = LocalCache();
+        if (Cache.Blocks.empty()) {
+            auto& Depot = GetDepot();
+            std::unique_lock Lock(Depot.Mutex);
+            if (!Depot.Magazines.empty()) {
+                Cache.Blocks = std::move(Depot.Magazines.back());
+                Depot.Magazines.pop_back();
+            }
+        }
+        if (Cache.Blocks.empty()) {
+            return ::operator new(Size, std::align_val_t(Align));
+        }
+        void* Block = Cache.Blocks.back();
+        Cache.Blocks.pop_back();
+        return Block;
+    }
+
+    static void Deallocate(void* Block) {
+        auto& Cache = LocalCache();
+        Cache.Blocks.push_back(Block);
+        if (Cache.Blocks.size() >= 2 * MagazineSize) {
+            std::vector<void*> Magazine(Cache.Blocks.end() - MagazineSize, Cache.Blocks.end());
+            Cache.Blocks.resize(Cache.Blocks.size() - MagazineSize);
+            GiveToDepot(std::move(Magazine));
+        }
+    }
+
+private:
+    struct TDepot {
+        std::mutex Mutex;
+        std::vector<std::vector<void*>> Magazines;
+    };
+    struct TCache {
+        std::vector<void*> Blocks;
+        ~TCache() {
+            // the thread exits, hand its blocks to whoever needs them next
+            while (!Blocks.empty()) {
+                auto Count = std::min(Blocks.size(), MagazineSize);
+                std::vector<void*> Magazine(Blocks.end() - Count, Blocks.end());
+                Blocks.resize(Blocks.size() - Count);
+                GiveToDepot(std::move(Magazine));
+            }
+        }
+    };
+
+    static void GiveToDepot(std::vector<void*>&& Magazine) {
+        auto& Depot = GetDepot();
+        {
+            std::unique_lock Lock(Depot.Mutex);
+            if (Depot.Magazines.size() < MaxDepotMagazines) {
+                Depot.Magazines.push_back(std::move(Magazine));
+                return;
+            }
+        }
+        for (void* Block : Magazine) {
+            ::operator delete(Block, std::align_val_t(Align));
+        }
+    }
+
+    static TCache& LocalCache() {
+        thread_local TCache Cache;
+        return Cache;
+    }
+
+    static TDepot& GetDepot() {
+        // never destroyed, as threads may still exit (and return blocks) during static destruction
+        static auto* Depot = new TDepot;
+        return *Depot;
+    }
+};
+
+// Allocator for single objects out of a TBlockPool, e.g. for std::allocate_shared.
+template <typename T>
+struct TPoolAllocator {
+    using value_type = T;
+
+    TPoolAllocator() = default;
+    template <typename U>
+    TPoolAllocator(const TPoolAllocator<U>&) { }
+
+    T* allocate(size_t N) {
+        if (N != 1) {
+            return std::allocator<T>().allocate(N);
+        }
+        return static_cast<T*>(TBlockPool<sizeof(T), alignof(T)>::Allocate());
+    }
+    void deallocate(T* Ptr, size_t N) {
+        if (N != 1) {
+            std::allocator<T>().deallocate(Ptr, N);
+            return;
+        }
+        TBlockPool<sizeof(T), alignof(T)>::Deallocate(Ptr);
+    }
+
+    template <typename U>
+    bool operator==(const TPoolAllocator<U>&) const { return true; }
+};
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "Cryptography.h"
+#include "TLogSink.h"
 #include "commandline.h"
 #include <atomic>
 #include <fstream>
@@ -43,6 +44,8 @@ public:
     void InitializeLuaConsole(TLuaEngine& Engine);
     void BackupOldLog();
     void StartLoggingToFile();
+    // Log lines which couldn't be written to the log file because it fell behind
+    [[nodiscard]] size_t DroppedLogLines() const { return mLogSink ? mLogSink->Dropped() : 0; }
     Commandline& Internal() { return *mCommandline; }
 
 private:
@@ -79,6 +82,9 @@ private:
         { "version", [this](const auto& a, const auto& b) { Command_Version(a, b); } },
     };
 
+    // declared before the commandline, so that it outlives the commandline's
+    // on_write hook
+    std::unique_ptr<TLogSink> mLogSink { nullptr };
     std::unique_ptr<Commandline> mCommandline { nullptr };
     std::vector<std::string> mCachedLuaHistory;
     std::vector<std::string> mCachedRegularHistory;
@@ -87,6 +93,4 @@ private:
     bool mFirstTime { true };
     std::string mStateId;
     const std::string mDefaultStateId = "BEAMMP_SERVER_CONSOLE";
-    std::ofstream mLogFileStream;
-    std::mutex mLogFileStreamMtx;
 };
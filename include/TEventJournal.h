@@ -0,0 +1,162 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "Environment.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Binary journal of network events, for debugging desyncs at packet rate
+// where text logging would be too slow. Records have a fixed size and are
+// written into a memory-mapped file used as a ring, so the file always holds
+// the most recent events. Decode it with the BeamMP-Server-journal tool.
+
+enum class TJournalKind : uint8_t {
+    TcpReceived = 1,
+    UdpReceived = 2,
+    // handled by TServer::GlobalParser, latency is the time spent handling it
+    Parsed = 3,
+    // latency is the time spent writing to the socket
+    TcpSent = 4,
+    UdpSent = 5,
+};
+
+inline const char* JournalKindName(TJournalKind Kind) {
+    switch (Kind) {
+    case TJournalKind::TcpReceived:
+        return "tcp_recv";
+    case TJournalKind::UdpReceived:
+        return "udp_recv";
+    case TJournalKind::Parsed:
+        return "parsed";
+    case TJournalKind::TcpSent:
+        return "tcp_send";
+    case TJournalKind::UdpSent:
+        return "udp_send";
+    }
+    return "unknown";
+}
+
+struct TJournalRecord {
+    // 1-based position in the journal, 0 if this record was never written
+    uint64_t Sequence;
+    // nanoseconds since the unix epoch
+    uint64_t TimestampNs;
+    int32_t PlayerID;
+    uint32_t Size;
+    uint32_t LatencyUs;
+    uint8_t Code;
+    TJournalKind Kind;
+    uint16_t Reserved;
+};
+static_assert(sizeof(TJournalRecord) == 32);
+
+struct TJournalFileHeader {
+    static constexpr char ExpectedMagic[8] = { 'B', 'M', 'P', 'J', 'R', 'N', 'L', '\0' };
+    static constexpr uint32_t CurrentVersion = 1;
+
+    char Magic[8];
+    uint32_t Version;
+    uint32_t RecordSize;
+    uint64_t Capacity;
+    uint64_t CreatedNs;
+    uint8_t Reserved[32];
+};
+static_assert(sizeof(TJournalFileHeader) == 64);
+
+class TEventJournal {
+public:
+    // Records the event with the time from construction to destruction as
+    // its latency.
+    class TScope {
+    public:
+        TScope(TEventJournal* Journal, TJournalKind Kind, int PlayerID, uint8_t Code, size_t Size);
+        TScope(const TScope&) = delete;
+        TScope& operator=(const TScope&) = delete;
+        ~TScope();
+
+    private:
+        TEventJournal* mJournal;
+        TJournalKind mKind;
+        int mPlayerID;
+        uint8_t mCode;
+        size_t mSize;
+        std::chrono::steady_clock::time_point mStart;
+    };
+
+    // Disabled until Open() succeeds.
+    TEventJournal() = default;
+    TEventJournal(const TEventJournal&) = delete;
+    TEventJournal& operator=(const TEventJournal&) = delete;
+    ~TEventJournal();
+
+    // Creates (or truncates) `Path` and maps it as a ring of `Capacity` records.
+    // Not thread-safe, call before any thread records.
+    bool Open(const std::string& Path, size_t Capacity);
+    void Close();
+    [[nodiscard]] bool IsEnabled() const { return mRecords != nullptr; }
+
+    // Thread-safe and lock-free, does nothing if the journal is disabled.
+    void Record(TJournalKind Kind, int PlayerID, uint8_t Code, size_t Size, std::chrono::nanoseconds Latency = {});
+    [[nodiscard]] TScope Measure(TJournalKind Kind, int PlayerID, uint8_t Code, size_t Size) {
+        return TScope(IsEnabled() ? this : nullptr, Kind, PlayerID, Code, Size);
+    }
+    [[nodiscard]] uint64_t Count() const { return mNext.load(std::memory_order_relaxed); }
+
+private:
+    void* mMapping { nullptr };
+    size_t mMappingSize { 0 };
+#ifdef BEAMMP_WINDOWS
+    void* mFileHandle { nullptr };
+    void* mMappingHandle { nullptr };
+#endif
+    TJournalRecord* mRecords { nullptr };
+    size_t mCapacity { 0 };
+    std::atomic<uint64_t> mNext { 0 };
+};
+
+// Reads all records that were written to a journal file, oldest first.
+// Doesn't need the server, so that the decoder tool can use it on its own.
+inline std::optional<std::vector<TJournalRecord>> ReadEventJournal(const std::string& Path) {
+    std::ifstream File(Path, std::ios::binary);
+    TJournalFileHeader Header {};
+    if (!File.read(reinterpret_cast<char*>(&Header), sizeof(Header))
+        || std::memcmp(Header.Magic, TJournalFileHeader::ExpectedMagic, sizeof(Header.Magic)) != 0
+        || Header.Version != TJournalFileHeader::CurrentVersion
+        || Header.RecordSize != sizeof(TJournalRecord)) {
+        return std::nullopt;
+    }
+    std::vector<TJournalRecord> Records(Header.Capacity);
+    File.read(reinterpret_cast<char*>(Records.data()), std::streamsize(Records.size() * sizeof(TJournalRecord)));
+    Records.resize(size_t(File.gcount()) / sizeof(TJournalRecord));
+    std::erase_if(Records, [](const TJournalRecord& Record) { return Record.Sequence == 0; });
+    std::sort(Records.begin(), Records.end(), [](const TJournalRecord& A, const TJournalRecord& B) {
+        return A.Sequence < B.Sequence;
+    });
+    return Records;
+}
@@ -0,0 +1,106 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stop_token>
+#include <string>
+
+// One stage of joining the server (authentication, resource sync, world sync).
+// At most `Limit()` clients are in a stage at a time, all others wait in
+// FIFO order. A limit of 0 or less means no limit.
+class TJoinStage {
+public:
+    struct TStats {
+        size_t Active { 0 };
+        size_t Queued { 0 };
+        size_t PeakQueued { 0 };
+        size_t Completed { 0 };
+        int Limit { 0 };
+        std::chrono::milliseconds AverageWait { 0 };
+        std::chrono::milliseconds MaxWait { 0 };
+    };
+
+    /// Releases the stage slot when destroyed.
+    class TSlot {
+    public:
+        explicit TSlot(TJoinStage& Stage);
+        TSlot(const TSlot&) = delete;
+        TSlot& operator=(const TSlot&) = delete;
+        ~TSlot();
+
+    private:
+        TJoinStage& mStage;
+    };
+
+    TJoinStage(std::string Name, std::function<int()> Limit);
+
+    /// Waits until this caller may enter the stage. Returns no slot if the
+    /// server shuts down while waiting, in which case the caller should give up
+    /// on the join.
+    [[nodiscard]] std::optional<TSlot> Enter();
+    [[nodiscard]] std::optional<TSlot> Enter(std::stop_token Stop);
+    /// Wakes up queued callers so they see a raised limit right away.
+    void LimitChanged();
+    [[nodiscard]] TStats Stats() const;
+    [[nodiscard]] const std::string& Name() const { return mName; }
+
+private:
+    void Leave();
+    // moves mNextAdmitted on to the next ticket whose holder is still waiting
+    void AdvanceAdmittedLocked();
+
+    std::string mName;
+    std::function<int()> mLimit;
+    mutable std::mutex mMutex;
+    // _any, to also wake up on a stop request
+    std::condition_variable_any mCondition;
+    uint64_t mNextTicket { 0 };
+    uint64_t mNextAdmitted { 0 };
+    // tickets of callers which stopped waiting before their turn
+    std::set<uint64_t> mAbandoned;
+    size_t mActive { 0 };
+    size_t mPeakQueued { 0 };
+    size_t mCompleted { 0 };
+    std::chrono::steady_clock::duration mTotalWait { 0 };
+    std::chrono::steady_clock::duration mMaxWait { 0 };
+};
+
+// The stages every joining client goes through, in order.
+struct TJoinPipeline {
+    TJoinPipeline();
+    TJoinPipeline(const TJoinPipeline&) = delete;
+    TJoinPipeline& operator=(const TJoinPipeline&) = delete;
+    ~TJoinPipeline();
+
+    TJoinStage Auth;
+    TJoinStage ResourceSync;
+    TJoinStage WorldSync;
+
+private:
+    // wakes the stages when a limit is changed from the console
+    size_t mSettingsListener;
+};
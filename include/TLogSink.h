@@ -0,0 +1,118 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Writes log lines to a file on a background thread, so that threads which
+// log don't wait for the disk.
+//
+// Lines go through a bounded lock-free ring buffer (multiple producers, one
+// consumer). The writer thread drains it in batches, and fsyncs the file at
+// most once per `SyncInterval` (0 syncs after every batch). If the ring is
+// full, lines are dropped and counted, and a note with the count is written
+// to the file once there is room again.
+//
+// The writer thread also rotates the file once it gets too big or too old:
+// "Server.log" is renamed to e.g. "Server.2024-01-31_12-00-00.log", and a new
+// "Server.log" is started. Rotated files are queued for a compressor thread,
+// which gzips them one after another and keeps only the newest archives, so
+// the writer never waits for compression.
+class TLogSink {
+public:
+    struct TRotation {
+        // 0: no size limit
+        size_t MaxBytes { 0 };
+        // 0: no age limit
+        std::chrono::seconds MaxAge { 0 };
+        // how many compressed archives to keep, 0 keeps all of them
+        size_t KeepArchives { 0 };
+    };
+
+    TLogSink(const std::string& Path, size_t Capacity, std::function<std::chrono::milliseconds()> SyncInterval, std::function<TRotation()> Rotation = {});
+    TLogSink(const TLogSink&) = delete;
+    TLogSink& operator=(const TLogSink&) = delete;
+    // Writes out everything still buffered, syncs and closes the file.
+    ~TLogSink();
+
+    [[nodiscard]] bool IsOpen() const { return mOpen; }
+    // Never blocks. Returns false if the line had to be dropped.
+    bool Write(std::string Line);
+    [[nodiscard]] size_t Dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+private:
+    struct TSlot {
+        std::atomic<uint64_t> Sequence;
+        std::string Line;
+    };
+
+    bool TryPop(std::string& Line);
+    void WriterMain();
+    void Sync();
+    [[nodiscard]] bool ShouldRotate(const TRotation& Rotation) const;
+    void Rotate(const TRotation& Rotation);
+    void CompressorMain();
+    static void CompressAndPrune(const std::string& Path, const std::string& Rotated, size_t KeepArchives);
+
+    struct TPendingArchive {
+        std::string Rotated;
+        size_t KeepArchives;
+    };
+
+    std::string mPath;
+    // only touched by the writer thread after construction
+    std::FILE* mFile { nullptr };
+    bool mOpen { false };
+    size_t mFileSize { 0 };
+    std::chrono::steady_clock::time_point mFileOpened;
+    std::function<std::chrono::milliseconds()> mSyncInterval;
+    std::function<TRotation()> mRotation;
+    std::mutex mCompressorMutex;
+    std::condition_variable mCompressorCondition;
+    std::deque<TPendingArchive> mPendingArchives;
+    bool mCompressorStopping { false };
+    std::thread mCompressor;
+    size_t mCapacity;
+    std::unique_ptr<TSlot[]> mSlots;
+    alignas(64) std::atomic<uint64_t> mEnqueuePos { 0 };
+    // only touched by the writer thread
+    alignas(64) uint64_t mDequeuePos { 0 };
+    std::atomic<size_t> mDropped { 0 };
+    // bumped after every write. When idle, the writer thread sets
+    // mWriterWaiting and sleeps on mWakeupCondition, and only then do writers
+    // take mWakeupMutex to wake it up
+    std::atomic<uint32_t> mWakeups { 0 };
+    std::atomic<bool> mWriterWaiting { false };
+    std::mutex mWakeupMutex;
+    std::condition_variable mWakeupCondition;
+    std::atomic<bool> mStopping { false };
+    std::thread mWriter;
+};
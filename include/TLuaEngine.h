@@ -19,23 +19,28 @@
 #pragma once
 
 #include "Profiling.h"
+#include "TBlockPool.h"
+#include "TMPSCQueue.h"
 #include "TNetwork.h"
 #include "TServer.h"
+#include "TStringInterner.h"
+#include "TTimerQueue.h"
 #include <any>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <filesystem>
 #include <initializer_list>
-#include <list>
 #include <lua.hpp>
 #include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
-#include <queue>
+#include <optional>
 #include <random>
 #include <set>
 #include <toml.hpp>
 #include <unordered_map>
+#include <variant>
 #include <vector>
 
 #define SOL_ALL_SAFETIES_ON 1
@@ -68,24 +73,53 @@ enum TLuaType {
     Float = 5,
 };
 
+// The arguments of one event, made once and shared by every state it's dispatched to,
+// so they're never modified after that. May be null if there are no arguments.
+using TLuaArgs = std::shared_ptr<const std::vector<TLuaValue>>;
+
+template <typename... ArgsT>
+TLuaArgs MakeLuaArgs(ArgsT&&... Args) {
+    if constexpr (sizeof...(Args) == 0) {
+        return nullptr;
+    } else {
+        using TValues = std::vector<TLuaValue>;
+        auto Values = std::allocate_shared<TValues>(TPoolAllocator<TValues> {});
+        Values->reserve(sizeof...(Args));
+        (Values->emplace_back(std::forward<ArgsT>(Args)), ...);
+        return Values;
+    }
+}
+
 class TLuaPlugin;
 
+// Outcome of a queued script or function call. Filled in by the state's thread,
+// which then marks it as ready.
 struct TLuaResult {
-    bool Ready;
-    bool Error;
+    std::atomic<bool> Ready { false };
+    bool Error { false };
     std::string ErrorMessage;
     sol::object Result { sol::lua_nil };
     TLuaStateId StateId;
     std::string Function;
-    std::shared_ptr<std::mutex> ReadyMutex {
-        std::make_shared<std::mutex>()
-    };
-    std::shared_ptr<std::condition_variable> ReadyCondition {
-        std::make_shared<std::condition_variable>()
-    };
+
+    // The result and its shared_ptr control block are one allocation, from a pool.
+    static std::shared_ptr<TLuaResult> Create();
 
     void MarkAsReady();
+    // Logs the error (if any) as soon as the result is ready, from whichever thread makes
+    // it ready, or right away if it already is. Logs each error only once.
+    void ReportErrorOnCompletion();
     void WaitUntilReady();
+    // Returns false if the result still wasn't ready at the deadline.
+    bool WaitUntilReady(std::chrono::steady_clock::time_point Deadline);
+
+private:
+    void ReportError();
+
+    // how many threads are waiting for this result, so that MarkAsReady() only wakes anyone if needed
+    std::atomic<uint32_t> mWaiters { 0 };
+    std::atomic<bool> mReportRequested { false };
+    std::atomic<bool> mReported { false };
 };
 
 struct TLuaPluginConfig {
@@ -104,6 +138,31 @@ struct TLuaChunk {
     std::string PluginPath;
 };
 
+// Resolves handler names, like "onChat" or "MyPlugin.onChat", to the functions they refer
+// to in one Lua state, and keeps them around, so that dispatching an event doesn't compile
+// a "return <name>" chunk every time. Only to be used by the thread which owns the state.
+class TLuaHandlerCache {
+public:
+    struct THandler {
+        sol::protected_function Fn;
+        // Fn, but errors come with a traceback
+        sol::protected_function WithTraceback;
+    };
+    // Returns std::nullopt if the name doesn't refer to a function (yet).
+    // EventName is only used for error messages.
+    std::optional<THandler> Get(sol::state_view StateView, TStringId Handler, const std::string& EventName);
+    // Has to be called whenever code ran in the state, since any handler may have been redefined.
+    void Invalidate() { mHandlers.clear(); }
+    size_t Size() const { return mHandlers.size(); }
+
+private:
+    struct TEntry {
+        sol::object Resolved;
+        THandler Handler;
+    };
+    std::unordered_map<TStringId, TEntry> mHandlers;
+};
+
 class TLuaEngine : public std::enable_shared_from_this<TLuaEngine>, IThreaded {
 public:
     enum CallStrategy : int {
@@ -112,16 +171,14 @@ public:
     };
 
     struct QueuedFunction {
-        std::string FunctionName;
+        TStringId FunctionName;
         std::shared_ptr<TLuaResult> Result;
-        std::vector<TLuaValue> Args;
-        std::string EventName; // optional, may be empty
+        TLuaArgs Args;
+        TStringId EventName; // optional, may be the empty string
     };
 
     TLuaEngine();
-    virtual ~TLuaEngine() noexcept {
-        beammp_debug("Lua Engine terminated");
-    }
+    virtual ~TLuaEngine() noexcept;
 
     void operator()() override;
 
@@ -131,10 +188,7 @@ public:
     void SetNetwork(TNetwork* Network) { mNetwork = Network; }
     void SetServer(TServer* Server) { mServer = Server; }
 
-    size_t GetResultsToCheckSize() {
-        std::unique_lock Lock(mResultsToCheckMutex);
-        return mResultsToCheck.size();
-    }
+    size_t GetQueuedWorkCount();
 
     size_t GetLuaStateCount() {
         std::unique_lock Lock(mLuaStatesMutex);
@@ -149,27 +203,21 @@ public:
     }
     size_t GetTimedEventsCount() {
         std::unique_lock Lock(mTimedEventsMutex);
-        return mTimedEvents.size();
+        return mTimedEvents.Size();
     }
     size_t GetRegisteredEventHandlerCount() {
-        std::unique_lock Lock(mLuaEventsMutex);
-        size_t LuaEventsCount = 0;
-        for (const auto& State : mLuaEvents) {
-            for (const auto& Events : State.second) {
-                LuaEventsCount += Events.second.size();
-            }
-        }
-        return LuaEventsCount - GetLuaStateCount();
+        // every state has an onInit handler registered for it
+        return mLuaEvents.load(std::memory_order_acquire)->HandlerCount - GetLuaStateCount();
     }
 
+    // Returns as soon as all results are ready, or once Max has passed since the call.
     static void WaitForAll(std::vector<std::shared_ptr<TLuaResult>>& Results,
         const std::optional<std::chrono::high_resolution_clock::duration>& Max = std::nullopt);
     void ReportErrors(const std::vector<std::shared_ptr<TLuaResult>>& Results);
     bool HasState(TLuaStateId StateId);
     [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueScript(TLuaStateId StateID, const TLuaChunk& Script);
-    [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueFunctionCall(TLuaStateId StateID, const std::string& FunctionName, const std::vector<TLuaValue>& Args, const std::string& EventName);
+    [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueFunctionCall(TLuaStateId StateID, const std::string& FunctionName, const TLuaArgs& Args, const std::string& EventName);
     void EnsureStateExists(TLuaStateId StateId, const std::string& Name, bool DontCallOnInit = false);
-    void RegisterEvent(const std::string& EventName, TLuaStateId StateId, const std::string& FunctionName);
     /**
      *
      * @tparam ArgsT Template Arguments for the event (Metadata) todo: figure out what this means
@@ -180,58 +228,74 @@ public:
      */
     template <typename... ArgsT>
     [[nodiscard]] std::vector<std::shared_ptr<TLuaResult>> TriggerEvent(const std::string& EventName, TLuaStateId IgnoreId, ArgsT&&... Args) {
-        std::unique_lock Lock(mLuaEventsMutex);
         beammp_event(EventName);
-        if (mLuaEvents.find(EventName) == mLuaEvents.end()) { // if no event handler is defined for 'EventName', return immediately
+        auto& Interner = TStringInterner::Global();
+        // names are interned when a handler is registered for them
+        const auto EventId = Interner.Find(EventName);
+        const auto Registry = mLuaEvents.load(std::memory_order_acquire);
+        auto Iter = EventId ? Registry->Events.find(EventId.value()) : Registry->Events.end();
+        if (Iter == Registry->Events.end()) { // if no event handler is defined for 'EventName', return immediately
             return {};
         }
 
         std::vector<std::shared_ptr<TLuaResult>> Results;
-        std::vector<TLuaValue> Arguments { TLuaValue { std::forward<ArgsT>(Args) }... };
-
-        for (const auto& Event : mLuaEvents.at(EventName)) {
-            for (const auto& Function : Event.second) {
-                if (Event.first != IgnoreId) {
-                    auto Result = EnqueueFunctionCall(Event.first, Function, Arguments, EventName);
-                    Results.push_back(Result);
-                    AddResultToCheck(Result);
-                }
+        const auto Arguments = MakeLuaArgs(std::forward<ArgsT>(Args)...);
+        const auto Ignore = Interner.Find(IgnoreId);
+
+        for (const auto& Handler : Iter->second) {
+            if (Handler.StateId != Ignore) {
+                auto Result = Handler.State->EnqueueFunctionCall(Handler.FunctionName, Arguments, EventId.value());
+                Result->ReportErrorOnCompletion();
+                Results.push_back(Result);
             }
         }
-        return Results; //
+        return Results;
     }
     template <typename... ArgsT>
     [[nodiscard]] std::vector<std::shared_ptr<TLuaResult>> TriggerLocalEvent(const TLuaStateId& StateId, const std::string& EventName, ArgsT&&... Args) {
-        std::unique_lock Lock(mLuaEventsMutex);
         beammp_event(EventName + " in '" + StateId + "'");
-        if (mLuaEvents.find(EventName) == mLuaEvents.end()) { // if no event handler is defined for 'EventName', return immediately
+        auto& Interner = TStringInterner::Global();
+        const auto EventId = Interner.Find(EventName);
+        const auto StateKey = Interner.Find(StateId);
+        const auto Registry = mLuaEvents.load(std::memory_order_acquire);
+        auto Iter = EventId ? Registry->Events.find(EventId.value()) : Registry->Events.end();
+        if (Iter == Registry->Events.end() || !StateKey) { // if no event handler is defined for 'EventName', return immediately
             return {};
         }
         std::vector<std::shared_ptr<TLuaResult>> Results;
-        std::vector<TLuaValue> Arguments { TLuaValue { std::forward<ArgsT>(Args) }... };
-        const auto Handlers = GetEventHandlersForState(EventName, StateId);
-        for (const auto& Handler : Handlers) {
-            Results.push_back(EnqueueFunctionCall(StateId, Handler, Arguments, EventName));
+        const auto Arguments = MakeLuaArgs(std::forward<ArgsT>(Args)...);
+        for (const auto& Handler : Iter->second) {
+            if (Handler.StateId == StateKey.value()) {
+                Results.push_back(Handler.State->EnqueueFunctionCall(Handler.FunctionName, Arguments, EventId.value()));
+            }
         }
         return Results;
     }
-    std::set<std::string> GetEventHandlersForState(const std::string& EventName, TLuaStateId StateId);
-    void CreateEventTimer(const std::string& EventName, TLuaStateId StateId, size_t IntervalMS, CallStrategy Strategy);
+    std::vector<TStringId> GetEventHandlersForState(TStringId EventName, TStringId StateId);
+    std::vector<TStringId> GetEventHandlersForState(const std::string& EventName, TStringId StateId);
     void CancelEventTimers(const std::string& EventName, TLuaStateId StateId);
     sol::state_view GetStateForPlugin(const fs::path& PluginPath);
     TLuaStateId GetStateIDForPlugin(const fs::path& PluginPath);
-    void AddResultToCheck(const std::shared_ptr<TLuaResult>& Result);
 
     static constexpr const char* BeamMPFnNotFoundError = "BEAMMP_FN_NOT_FOUND";
 
     std::vector<std::string> GetStateGlobalKeysForState(TLuaStateId StateId);
     std::vector<std::string> GetStateTableKeysForState(TLuaStateId StateId, std::vector<std::string> keys);
 
+    struct TimerInfo {
+        std::string EventName;
+        std::chrono::milliseconds Interval;
+        size_t Fired;
+        size_t Skipped;
+        // how late the timer fired
+        std::chrono::microseconds AverageDrift;
+        std::chrono::microseconds MaxDrift;
+    };
+
     // Debugging functions (slow)
+    std::vector<TimerInfo> Debug_GetTimersForState(TLuaStateId StateId);
     std::unordered_map<std::string /*event name */, std::vector<std::string> /* handlers */> Debug_GetEventsForState(TLuaStateId StateId);
-    std::queue<std::pair<TLuaChunk, std::shared_ptr<TLuaResult>>> Debug_GetStateExecuteQueueForState(TLuaStateId StateId);
-    std::vector<QueuedFunction> Debug_GetStateFunctionQueueForState(TLuaStateId StateId);
-    std::vector<TLuaResult> Debug_GetResultsToCheckForState(TLuaStateId StateId);
+    size_t Debug_GetStateFunctionQueueSizeForState(TLuaStateId StateId);
 
 private:
     void CollectAndInitPlugins();
@@ -245,21 +309,46 @@ private:
         StateThreadData(const StateThreadData&) = delete;
         virtual ~StateThreadData() noexcept { beammp_debug("\"" + mStateId + "\" destroyed"); }
         [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueScript(const TLuaChunk& Script);
-        [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueFunctionCall(const std::string& FunctionName, const std::vector<TLuaValue>& Args, const std::string& EventName);
-        [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueFunctionCallFromCustomEvent(const std::string& FunctionName, const std::vector<TLuaValue>& Args, const std::string& EventName, CallStrategy Strategy);
+        [[nodiscard]] std::shared_ptr<TLuaResult> EnqueueFunctionCall(TStringId FunctionName, const TLuaArgs& Args, TStringId EventName);
+        // Calls all handlers of the event in this state. Returns false if the tick was skipped.
+        [[nodiscard]] bool EnqueueTimerTick(TStringId EventName, CallStrategy Strategy);
         void RegisterEvent(const std::string& EventName, const std::string& FunctionName);
         void AddPath(const fs::path& Path); // to be added to path and cpath
         void operator()() override;
+        // Makes the thread exit once it's done with what it's doing right now. Doesn't wait for it.
+        void Stop();
+        void Join();
         sol::state_view State() { return sol::state_view(mState); }
+        TStringId InternedStateId() const { return mInternedStateId; }
 
         std::vector<std::string> GetStateGlobalKeys();
         std::vector<std::string> GetStateTableKeys(const std::vector<std::string>& keys);
 
         // Debug functions, slow
-        std::queue<std::pair<TLuaChunk, std::shared_ptr<TLuaResult>>> Debug_GetStateExecuteQueue();
-        std::vector<TLuaEngine::QueuedFunction> Debug_GetStateFunctionQueue();
+        size_t Debug_GetStateFunctionQueueSize() const { return mWorkQueue.Size(); }
 
     private:
+        struct QueuedScript {
+            TLuaChunk Chunk;
+            std::shared_ptr<TLuaResult> Result;
+        };
+        struct QueuedTimerTick {
+            TStringId EventName;
+            CallStrategy Strategy;
+        };
+        struct QueuedPath {
+            fs::path Path;
+        };
+        // Everything the state's thread does comes through one queue, in order.
+        // std::monostate does nothing, it's only pushed to wake the thread up.
+        using QueuedWork = std::variant<std::monostate, QueuedScript, QueuedFunction, QueuedTimerTick, QueuedPath>;
+
+        void AddToPackagePaths(const fs::path& Path);
+        void ExecuteScript(QueuedScript& Script);
+        void CallQueuedFunction(QueuedFunction& Function);
+        // Converts the arguments to Lua, or returns the last conversion if they're the same.
+        const std::vector<sol::object>& ToLuaArgs(const TLuaArgs& Args);
+        void CallTimerHandlers(const QueuedTimerTick& Tick);
         sol::table Lua_TriggerGlobalEvent(const std::string& EventName, sol::variadic_args EventArgs);
         sol::table Lua_TriggerLocalEvent(const std::string& EventName, sol::variadic_args EventArgs);
         sol::table Lua_GetPlayerIdentifiers(int ID);
@@ -276,48 +365,75 @@ private:
 
         prof::UnitProfileCollection mProfile {};
         std::unordered_map<std::string, prof::TimePoint> mProfileStarts;
+        // per handler, only used by this state's thread
+        std::unordered_map<TStringId, prof::UnitExecutionTime> mHandlerProfile;
+        // all handlers of an event in this state get the same arguments, so they're converted
+        // once, and kept until the end of the batch
+        TLuaArgs mConvertedArgs;
+        std::vector<sol::object> mConvertedLuaArgs;
 
         std::string mName;
         TLuaStateId mStateId;
+        TStringId mInternedStateId;
         lua_State* mState;
-        std::thread mThread;
-        std::queue<std::pair<TLuaChunk, std::shared_ptr<TLuaResult>>> mStateExecuteQueue;
-        std::recursive_mutex mStateExecuteQueueMutex;
-        std::vector<QueuedFunction> mStateFunctionQueue;
-        std::mutex mStateFunctionQueueMutex;
-        std::condition_variable mStateFunctionQueueCond;
+        TMPSCQueue<QueuedWork> mWorkQueue;
+        std::atomic<bool> mStopping { false };
+        // how many BestEffort timer ticks are queued per event
+        std::unordered_map<TStringId, size_t> mBestEffortQueued;
+        std::mutex mBestEffortQueuedMutex;
+        TLuaHandlerCache mHandlerCache;
         TLuaEngine* mEngine;
         sol::state_view mStateView { mState };
-        std::queue<fs::path> mPaths;
-        std::recursive_mutex mPathsMutex;
         std::mt19937 mMersenneTwister;
         std::uniform_real_distribution<double> mUniformRealDistribution01;
-        std::vector<sol::object> JsonStringToArray(JsonString Str);
+        std::vector<sol::object> JsonStringToArray(const JsonString& Str);
     };
 
     struct TimedEvent {
-        std::chrono::high_resolution_clock::duration Duration {};
-        std::chrono::high_resolution_clock::time_point LastCompletion {};
-        std::string EventName;
-        TLuaStateId StateId;
+        TStringId EventName;
+        TStringId StateId;
+        // states live as long as the engine
+        StateThreadData* State;
         CallStrategy Strategy;
-        bool Expired();
-        void Reset();
     };
 
+    // Which states handle which events. Never modified once published: registering a
+    // handler publishes a modified copy, so that dispatching an event needs no lock.
+    struct EventRegistry {
+        struct Handler {
+            TStringId StateId;
+            // states live as long as the engine
+            StateThreadData* State;
+            TStringId FunctionName;
+        };
+        // sorted by state, then function name (as strings)
+        std::unordered_map<TStringId /* event name */, std::vector<Handler>> Events;
+        size_t HandlerCount { 0 };
+    };
+
+    // these take the state directly, as they're called from the state's own thread, which
+    // may be running onInit while mLuaStatesMutex is held
+    void RegisterEvent(const std::string& EventName, StateThreadData& State, const std::string& FunctionName);
+    void CreateEventTimer(const std::string& EventName, StateThreadData& State, size_t IntervalMS, CallStrategy Strategy);
+
     TNetwork* mNetwork;
     TServer* mServer;
     const fs::path mResourceServerPath;
     std::vector<std::shared_ptr<TLuaPlugin>> mLuaPlugins;
     std::unordered_map<TLuaStateId, std::unique_ptr<StateThreadData>> mLuaStates;
     std::recursive_mutex mLuaStatesMutex;
-    std::unordered_map<std::string /* event name */, std::unordered_map<TLuaStateId, std::set<std::string>>> mLuaEvents;
-    std::recursive_mutex mLuaEventsMutex;
-    std::vector<TimedEvent> mTimedEvents;
-    std::recursive_mutex mTimedEventsMutex;
-    std::list<std::shared_ptr<TLuaResult>> mResultsToCheck;
-    std::mutex mResultsToCheckMutex;
-    std::condition_variable mResultsToCheckCond;
+    // the current registry; a plain pointer, so that dispatching an event is a single load
+    std::atomic<const EventRegistry*> mLuaEvents { nullptr };
+    // every registry ever published, as other threads may still be dispatching from an
+    // old one. Handlers are rarely registered after startup, so they're never freed early.
+    std::vector<std::unique_ptr<const EventRegistry>> mLuaEventRegistries;
+    // only taken to publish a new registry
+    std::mutex mLuaEventsMutex;
+    TTimerQueue<TimedEvent> mTimedEvents;
+    std::mutex mTimedEventsMutex;
+    // wakes the engine's thread when a timer was added, or on shutdown
+    std::condition_variable mTimedEventsCond;
+    bool mTimedEventsChanged { false };
 };
 
 // std::any TriggerLuaEvent(const std::string& Event, bool local, TLuaPlugin* Caller, std::shared_ptr<TLuaArg> arg, bool Wait);
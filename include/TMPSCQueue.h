@@ -0,0 +1,148 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "TBlockPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Unbounded queue with any number of producers and exactly one consumer.
+//
+// Push() links a node with one atomic exchange. Nodes come from a TBlockPool,
+// which only takes a lock once per batch of nodes. The consumer
+// takes items from the other end without synchronizing with producers at all,
+// and can take many at once with PopBatch(). Only if the consumer is asleep in
+// WaitForItems() does a producer take a mutex, to wake it.
+template <typename T>
+class TMPSCQueue {
+public:
+    TMPSCQueue()
+        : mHead(NewNode())
+        , mTail(mHead.load()) { }
+    TMPSCQueue(const TMPSCQueue&) = delete;
+    TMPSCQueue& operator=(const TMPSCQueue&) = delete;
+    ~TMPSCQueue() {
+        while (TNode* Node = mTail) {
+            mTail = Node->Next.load(std::memory_order_relaxed);
+            DeleteNode(Node);
+        }
+    }
+
+    // Safe to call from any thread.
+    void Push(T Value) {
+        auto* Node = NewNode();
+        Node->Value.emplace(std::move(Value));
+        mSize.fetch_add(1, std::memory_order_relaxed);
+        TNode* Prev = mHead.exchange(Node, std::memory_order_acq_rel);
+        // seq_cst, so that either this store is seen by the consumer before it
+        // goes to sleep, or the consumer's mWaiting is seen here
+        Prev->Next.store(Node, std::memory_order_seq_cst);
+        if (mWaiting.load(std::memory_order_seq_cst)) {
+            std::unique_lock Lock(mWaitMutex);
+            mWaitCondition.notify_one();
+        }
+    }
+
+    // Consumer only. Returns false if the queue is empty.
+    bool TryPop(T& Out) {
+        TNode* Tail = mTail;
+        TNode* Next = Tail->Next.load(std::memory_order_acquire);
+        if (!Next) {
+            return false;
+        }
+        Out = std::move(*Next->Value);
+        Next->Value.reset();
+        // Next becomes the new (empty) tail node
+        mTail = Next;
+        DeleteNode(Tail);
+        mSize.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer only. Appends up to Max items to Out, returns how many.
+    size_t PopBatch(std::vector<T>& Out, size_t Max) {
+        size_t Count = 0;
+        T Value;
+        while (Count < Max && TryPop(Value)) {
+            Out.push_back(std::move(Value));
+            ++Count;
+        }
+        return Count;
+    }
+
+    // Consumer only. Returns as soon as there is something to pop.
+    void WaitForItems() {
+        if (HasItems()) {
+            return;
+        }
+        std::unique_lock Lock(mWaitMutex);
+        mWaiting.store(true, std::memory_order_seq_cst);
+        mWaitCondition.wait(Lock, [this] { return HasItems(); });
+        mWaiting.store(false, std::memory_order_relaxed);
+    }
+
+    // Consumer only. Returns as soon as there is something to pop, or false if
+    // there still isn't after Timeout.
+    template <typename Rep, typename Period>
+    bool WaitForItems(std::chrono::duration<Rep, Period> Timeout) {
+        if (HasItems()) {
+            return true;
+        }
+        std::unique_lock Lock(mWaitMutex);
+        mWaiting.store(true, std::memory_order_seq_cst);
+        bool Result = mWaitCondition.wait_for(Lock, Timeout, [this] { return HasItems(); });
+        mWaiting.store(false, std::memory_order_relaxed);
+        return Result;
+    }
+
+    // Approximate while producers are pushing.
+    [[nodiscard]] size_t Size() const { return mSize.load(std::memory_order_relaxed); }
+
+private:
+    struct TNode {
+        std::atomic<TNode*> Next { nullptr };
+        std::optional<T> Value;
+    };
+
+    // nodes come from a pool, so that a push usually doesn't allocate
+    using TNodePool = TBlockPool<sizeof(TNode), alignof(TNode)>;
+    static TNode* NewNode() { return new (TNodePool::Allocate()) TNode; }
+    static void DeleteNode(TNode* Node) {
+        Node->~TNode();
+        TNodePool::Deallocate(Node);
+    }
+
+    bool HasItems() const {
+        return mTail->Next.load(std::memory_order_seq_cst) != nullptr;
+    }
+
+    // producers push here
+    alignas(64) std::atomic<TNode*> mHead;
+    // the consumer pops here, always points at an empty node
+    alignas(64) TNode* mTail;
+    std::atomic<size_t> mSize { 0 };
+    std::atomic<bool> mWaiting { false };
+    std::mutex mWaitMutex;
+    std::condition_variable mWaitCondition;
+};
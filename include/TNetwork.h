@@ -20,20 +20,38 @@
 
 #include "BoostAliases.h"
 #include "Compat.h"
+#include "TAuthCache.h"
+#include "TJoinPipeline.h"
 #include "TResourceManager.h"
 #include "TServer.h"
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ip/udp.hpp>
+#include <span>
 
 struct TConnection;
 
+// Every vehicle on the server, encoded exactly as SyncClient would send them
+// one by one, so that a series of joining players can share one encoding.
+struct TWorldSnapshot {
+    uint64_t Version { 0 };
+    // size-prefixed frames, ready to be written to a socket as-is
+    std::vector<uint8_t> Frames;
+    struct TSegment {
+        int OwnerID;
+        size_t Offset;
+        size_t Size;
+    };
+    // where each vehicle's frame is in Frames
+    std::vector<TSegment> Segments;
+};
+
 class TNetwork {
 public:
     TNetwork(TServer& Server, TPPSMonitor& PPSMonitor, TResourceManager& ResourceManager);
 
-    [[nodiscard]] bool TCPSend(TClient& c, const std::vector<uint8_t>& Data, bool IsSync = false);
-    [[nodiscard]] bool SendLarge(TClient& c, std::vector<uint8_t> Data, bool isSync = false);
-    [[nodiscard]] bool Respond(TClient& c, const std::vector<uint8_t>& MSG, bool Rel, bool isSync = false);
+    [[nodiscard]] bool TCPSend(TClient& c, std::span<const uint8_t> Data, bool IsSync = false);
+    [[nodiscard]] bool SendLarge(TClient& c, std::span<const uint8_t> Data, bool isSync = false);
+    [[nodiscard]] bool Respond(TClient& c, std::span<const uint8_t> MSG, bool Rel, bool isSync = false);
     std::shared_ptr<TClient> CreateClient(ip::tcp::socket&& TCPSock);
     std::vector<uint8_t> TCPRcv(TClient& c);
     void ClientKick(TClient& c, const std::string& R);
@@ -44,6 +62,10 @@ public:
     [[nodiscard]] bool UDPSend(TClient& Client, std::vector<uint8_t> Data);
     void SendToAll(TClient* c, const std::vector<uint8_t>& Data, bool Self, bool Rel);
     void UpdatePlayer(TClient& Client);
+    [[nodiscard]] const TJoinPipeline& JoinPipeline() const { return mJoinPipeline; }
+    [[nodiscard]] const TAuthCache& AuthCache() const { return mAuthCache; }
+    // Returns the cached snapshot, or builds a new one if any vehicle changed since.
+    [[nodiscard]] std::shared_ptr<const TWorldSnapshot> GetWorldSnapshot();
 
 private:
     void UDPServerMain();
@@ -56,8 +78,13 @@ private:
     std::thread mUDPThread;
     std::thread mTCPThread;
     std::mutex mOpenIDMutex;
+    TJoinPipeline mJoinPipeline;
+    TAuthCache mAuthCache;
+    std::mutex mWorldSnapshotMutex;
+    std::shared_ptr<const TWorldSnapshot> mWorldSnapshot;
 
     std::vector<uint8_t> UDPRcvFromClient(ip::udp::endpoint& ClientEndpoint);
+    bool SendWorldSnapshot(TClient& c, const TWorldSnapshot& Snapshot);
     void OnConnect(const std::weak_ptr<TClient>& c);
     void TCPClient(const std::weak_ptr<TClient>& c);
     void Looper(const std::weak_ptr<TClient>& c);
@@ -72,3 +99,6 @@ private:
 
 std::string HashPassword(const std::string& str);
 std::vector<uint8_t> StringToVector(const std::string& Str);
+// Non-owning view of the string's bytes, for sending without a copy.
+// The string has to outlive the returned span.
+std::span<const uint8_t> StringToSpan(const std::string& Str);
@@ -20,10 +20,14 @@
 
 #include "IThreaded.h"
 #include "RWMutex.h"
+#include "TEventJournal.h"
 #include "TScopedTimer.h"
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string_view>
 #include <unordered_set>
 
 #include "BoostAliases.h"
@@ -50,6 +54,14 @@ public:
 
     const TScopedTimer UptimeTimer;
 
+    // Changes whenever any vehicle is spawned, edited or deleted, so that
+    // anything derived from the set of vehicles knows when to rebuild.
+    uint64_t VehicleStateVersion() const { return mVehicleStateVersion.load(); }
+    void BumpVehicleStateVersion() { ++mVehicleStateVersion; }
+
+    // disabled unless Misc.EventJournalRecords is set
+    TEventJournal& EventJournal() { return mEventJournal; }
+
     // asio io context
     io_context& IoCtx() { return mIoCtx; }
 
@@ -57,9 +69,11 @@ private:
     io_context mIoCtx {};
     TClientSet mClients;
     mutable RWMutex mClientsMutex;
+    std::atomic<uint64_t> mVehicleStateVersion { 0 };
+    TEventJournal mEventJournal;
     static void ParseVehicle(TClient& c, const std::string& Pckt, TNetwork& Network);
-    static bool ShouldSpawn(TClient& c, const std::string& CarJson, int ID);
-    static bool IsUnicycle(TClient& c, const std::string& CarJson);
+    static bool ShouldSpawn(TClient& c, bool IsUnicycle, int ID);
+    static bool IsUnicycle(TClient& c, std::string_view CarJson);
     static void Apply(TClient& c, int VID, const std::string& pckt);
     void HandlePosition(TClient& c, const std::string& Packet);
 };
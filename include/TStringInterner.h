@@ -0,0 +1,67 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include "RWMutex.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Stands in for an interned string: equal strings always get the same id.
+using TStringId = uint32_t;
+
+// Hands out small integer ids for names like events, states and handlers, so that
+// they can be hashed and compared as integers wherever they're passed around.
+// Interned strings are never freed, so intern names as they're registered, and only
+// Find() names that come from elsewhere (e.g. from Lua or the network).
+//
+// Get() doesn't lock. Find() and Intern() take a read lock, Intern() also takes a
+// write lock the first time it sees a string.
+class TStringInterner {
+public:
+    // The one used by the engine. Lives until the process exits.
+    static TStringInterner& Global();
+
+    TStringInterner() = default;
+    TStringInterner(const TStringInterner&) = delete;
+    TStringInterner& operator=(const TStringInterner&) = delete;
+    ~TStringInterner();
+
+    TStringId Intern(std::string_view Str);
+    // Returns std::nullopt if the string was never interned.
+    [[nodiscard]] std::optional<TStringId> Find(std::string_view Str);
+    // The id has to come from this interner.
+    [[nodiscard]] const std::string& Get(TStringId Id) const;
+    [[nodiscard]] size_t Size() const { return mSize.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t ChunkSize = 1024;
+    static constexpr size_t MaxChunks = 4096;
+
+    // strings live in chunks which never move, so Get() can index them without a lock,
+    // and mIds can use views of them as keys
+    std::array<std::atomic<std::string*>, MaxChunks> mChunks {};
+    std::atomic<size_t> mSize { 0 };
+    std::unordered_map<std::string_view, TStringId> mIds;
+    RWMutex mMutex;
+};
@@ -0,0 +1,173 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+// Repeating timers, kept in a min-heap by when they are next due, so that finding the
+// next one is O(1) and firing one is O(log n), no matter how many there are.
+//
+// Timers run at a fixed rate: the next tick is due one interval after the previous one
+// was *due*, not after it fired, so late ticks don't push the schedule back. Ticks
+// which were missed entirely (e.g. the thread was busy) are skipped, not fired in a burst.
+// How late each tick fired is kept as drift statistics per timer.
+//
+// Not thread safe.
+template <typename T>
+class TTimerQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct TStats {
+        size_t Fired { 0 };
+        // ticks that Fire() declined, or which were missed
+        size_t Skipped { 0 };
+        Clock::duration TotalDrift { 0 };
+        Clock::duration MaxDrift { 0 };
+        [[nodiscard]] Clock::duration AverageDrift() const {
+            return Fired == 0 ? Clock::duration(0) : TotalDrift / Clock::rep(Fired);
+        }
+    };
+
+    struct TTimer {
+        uint64_t Id;
+        T Data;
+        Clock::duration Interval;
+        Clock::time_point NextDue;
+        TStats Stats {};
+    };
+
+    // First due one interval from Now.
+    uint64_t Add(T Data, Clock::duration Interval, Clock::time_point Now = Clock::now()) {
+        // a zero interval would never stop being due
+        Interval = std::max<Clock::duration>(Interval, std::chrono::milliseconds(1));
+        const uint64_t Id = mNextId++;
+        mTimers.emplace(Id, TTimer { Id, std::move(Data), Interval, Now + Interval });
+        PushHeap(Now + Interval, Id);
+        return Id;
+    }
+
+    // Removes all timers for which Pred(Data) is true. Returns how many were removed.
+    template <typename Pred>
+    size_t RemoveIf(Pred&& Predicate) {
+        size_t Removed = std::erase_if(mTimers, [&](const auto& Pair) { return Predicate(Pair.second.Data); });
+        // their heap entries are dropped when they come up, or when there are too many
+        mStaleEntries += Removed;
+        if (mStaleEntries > mTimers.size()) {
+            RebuildHeap();
+        }
+        return Removed;
+    }
+
+    // When the next timer is due, or std::nullopt if there are no timers.
+    [[nodiscard]] std::optional<Clock::time_point> NextDue() {
+        DropStaleTop();
+        if (mHeap.empty()) {
+            return std::nullopt;
+        }
+        return mHeap.front().Due;
+    }
+
+    // Calls Fire(Data) for every timer which is due at Now. Fire returns false if it
+    // decided to skip this tick.
+    template <typename Fn>
+    void FireDue(Clock::time_point Now, Fn&& Fire) {
+        DropStaleTop();
+        while (!mHeap.empty() && mHeap.front().Due <= Now) {
+            const auto Entry = PopHeap();
+            auto Iter = mTimers.find(Entry.Id);
+            if (Iter == mTimers.end()) {
+                --mStaleEntries;
+                continue;
+            }
+            auto& Timer = Iter->second;
+            const auto Drift = Now - Timer.NextDue;
+            if (Fire(Timer.Data)) {
+                ++Timer.Stats.Fired;
+                Timer.Stats.TotalDrift += Drift;
+                Timer.Stats.MaxDrift = std::max(Timer.Stats.MaxDrift, Drift);
+            } else {
+                ++Timer.Stats.Skipped;
+            }
+            Timer.NextDue += Timer.Interval;
+            if (Timer.NextDue <= Now) {
+                const auto Missed = (Now - Timer.NextDue) / Timer.Interval + 1;
+                Timer.Stats.Skipped += size_t(Missed);
+                Timer.NextDue += Missed * Timer.Interval;
+            }
+            PushHeap(Timer.NextDue, Timer.Id);
+            DropStaleTop();
+        }
+    }
+
+    [[nodiscard]] size_t Size() const { return mTimers.size(); }
+
+    template <typename Fn>
+    void ForEach(Fn&& Function) const {
+        for (const auto& [Id, Timer] : mTimers) {
+            Function(Timer);
+        }
+    }
+
+private:
+    struct THeapEntry {
+        Clock::time_point Due;
+        uint64_t Id;
+        // makes std::push_heap & co. build a min-heap
+        bool operator<(const THeapEntry& Other) const { return Due > Other.Due; }
+    };
+
+    void PushHeap(Clock::time_point Due, uint64_t Id) {
+        mHeap.push_back({ Due, Id });
+        std::push_heap(mHeap.begin(), mHeap.end());
+    }
+
+    THeapEntry PopHeap() {
+        std::pop_heap(mHeap.begin(), mHeap.end());
+        auto Entry = mHeap.back();
+        mHeap.pop_back();
+        return Entry;
+    }
+
+    void DropStaleTop() {
+        while (!mHeap.empty() && !mTimers.contains(mHeap.front().Id)) {
+            PopHeap();
+            --mStaleEntries;
+        }
+    }
+
+    void RebuildHeap() {
+        mHeap.clear();
+        for (const auto& [Id, Timer] : mTimers) {
+            mHeap.push_back({ Timer.NextDue, Id });
+        }
+        std::make_heap(mHeap.begin(), mHeap.end());
+        mStaleEntries = 0;
+    }
+
+    std::unordered_map<uint64_t, TTimer> mTimers;
+    std::vector<THeapEntry> mHeap;
+    size_t mStaleEntries { 0 };
+    uint64_t mNextId { 1 };
+};
@@ -18,28 +18,64 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <string_view>
 
 class TVehicleData final {
 public:
-    TVehicleData(int ID, std::string Data);
+    TVehicleData(int ID, std::string Data, bool IsUnicycle = false);
+    // Copies are read-only snapshots: they carry the serialized config, any
+    // pending edits are flushed first and the parsed config is not shared.
+    TVehicleData(const TVehicleData& Other);
+    TVehicleData(TVehicleData&& Other) noexcept;
+    TVehicleData& operator=(const TVehicleData& Other);
+    TVehicleData& operator=(TVehicleData&& Other) noexcept;
     ~TVehicleData();
-    // We cannot delete this, since vector needs to be able to copy when it resizes.
-    // Deleting this causes some wacky template errors which are hard to decipher,
-    // and end up making no sense, so let's just leave the copy ctor.
-    // TVehicleData(const TVehicleData&) = delete;
 
     [[nodiscard]] bool IsInvalid() const { return mID == -1; }
     [[nodiscard]] int ID() const { return mID; }
+    // Whether the top-level "jbm" of the config is "unicycle", as determined on
+    // spawn and kept up to date by edits which change "jbm".
+    [[nodiscard]] bool IsUnicycle() const { return mIsUnicycle; }
 
-    [[nodiscard]] std::string Data() const { return mData; }
-    void SetData(const std::string& Data) { mData = Data; }
+    // The config is immutable once stored; edits replace the pointer, so
+    // callers may hold on to the returned data without holding any locks.
+    // Serializes pending edits first, if there are any, and decompresses
+    // the config if it's stored compactly.
+    [[nodiscard]] std::shared_ptr<const std::string> Data() const;
+    void SetData(std::string Data);
+    // Merges the top-level members of the JSON object `Patch` into the config.
+    // The config is parsed once and kept around, so repeated edits only parse
+    // the patch; serializing is deferred until the next Data() call.
+    bool ApplyEdit(std::string_view Patch);
+    // Approximate number of bytes used to hold this vehicle's config. A config
+    // shared by multiple vehicles is split evenly between them.
+    [[nodiscard]] size_t MemoryUsage() const;
+    // Number of distinct compactly stored configs which are alive right now.
+    [[nodiscard]] static size_t CompactConfigCount();
 
     bool operator==(const TVehicleData& v) const { return mID == v.mID; }
 
+    // Compressed json part of a config, shared between vehicles with identical configs.
+    struct TCompactConfig;
+
 private:
+    struct TEditState;
+
+    void FlushEdits() const;
+    // Stores the config either as-is or compactly, depending on Misc.CompactVehicleConfigs.
+    void Store(std::string Data) const;
+    size_t StoredSize() const;
+
     int mID { -1 };
-    std::string mData;
+    bool mIsUnicycle { false };
+    // either mData holds the config, or mHeader + mCompact do
+    mutable std::shared_ptr<const std::string> mData;
+    mutable std::string mHeader;
+    mutable std::shared_ptr<const TCompactConfig> mCompact;
+    mutable std::unique_ptr<TEditState> mEdits;
 };
 
 // TODO: unused now, remove?
@@ -31,6 +31,7 @@ void TClient::DeleteCar(int Ident) {
     });
     if (iter != mVehicleData.end()) {
         mVehicleData.erase(iter);
+        mServer.BumpVehicleStateVersion();
     } else {
         beammp_debug("tried to erase a vehicle that doesn't exist (not an error)");
     }
@@ -39,6 +40,7 @@ void TClient::DeleteCar(int Ident) {
 void TClient::ClearCars() {
     std::unique_lock lock(mVehicleDataMutex);
     mVehicleData.clear();
+    mServer.BumpVehicleStateVersion();
 }
 
 int TClient::GetOpenCarID() const {
@@ -57,9 +59,10 @@ int TClient::GetOpenCarID() const {
     return OpenID;
 }
 
-void TClient::AddNewCar(int Ident, const std::string& Data) {
+void TClient::AddNewCar(int Ident, std::string Data, bool IsUnicycle) {
     std::unique_lock lock(mVehicleDataMutex);
-    mVehicleData.emplace_back(Ident, Data);
+    mVehicleData.emplace_back(Ident, std::move(Data), IsUnicycle);
+    mServer.BumpVehicleStateVersion();
 }
 
 TClient::TVehicleDataLockPair TClient::GetAllCars() {
@@ -94,7 +97,7 @@ void TClient::SetCarPosition(int Ident, const std::string& Data) {
     mVehiclePosition[size_t(Ident)] = Data;
 }
 
-std::string TClient::GetCarData(int Ident) {
+std::shared_ptr<const std::string> TClient::GetCarData(int Ident) {
     { // lock
         std::unique_lock lock(mVehicleDataMutex);
         for (auto& v : mVehicleData) {
@@ -104,15 +107,16 @@ std::string TClient::GetCarData(int Ident) {
         }
     } // unlock
     DeleteCar(Ident);
-    return "";
+    return nullptr;
 }
 
-void TClient::SetCarData(int Ident, const std::string& Data) {
+void TClient::SetCarData(int Ident, std::string Data) {
     { // lock
         std::unique_lock lock(mVehicleDataMutex);
         for (auto& v : mVehicleData) {
             if (v.ID() == Ident) {
-                v.SetData(Data);
+                v.SetData(std::move(Data));
+                mServer.BumpVehicleStateVersion();
                 return;
             }
         }
@@ -120,6 +124,30 @@ void TClient::SetCarData(int Ident, const std::string& Data) {
     DeleteCar(Ident);
 }
 
+TClient::EditResult TClient::ApplyCarEdit(int Ident, std::string_view Patch) {
+    std::unique_lock lock(mVehicleDataMutex);
+    for (auto& v : mVehicleData) {
+        if (v.ID() == Ident) {
+            if (!v.ApplyEdit(Patch)) {
+                return EditResult::Invalid;
+            }
+            mServer.BumpVehicleStateVersion();
+            return EditResult::Applied;
+        }
+    }
+    return EditResult::NoSuchVehicle;
+}
+
+bool TClient::IsCarUnicycle(int Ident) const {
+    std::unique_lock lock(mVehicleDataMutex);
+    for (auto& v : mVehicleData) {
+        if (v.ID() == Ident) {
+            return v.IsUnicycle();
+        }
+    }
+    return false;
+}
+
 int TClient::GetCarCount() const {
     // mVechileData holds both unicycle and cars which both count towards the maximum car count
     // spawning a unicycle meant reaching the max, hence being unable to spawn car. this dirty fixes the problem for now.
@@ -132,6 +160,16 @@ int TClient::GetCarCount() const {
     return int(mVehicleData.size());
 }
 
+TClient::TCarsMemoryUsage TClient::GetCarsMemoryUsage() const {
+    std::unique_lock lock(mVehicleDataMutex);
+    TCarsMemoryUsage Usage;
+    for (auto& v : mVehicleData) {
+        Usage.Bytes += v.MemoryUsage();
+    }
+    Usage.Configs = mVehicleData.size();
+    return Usage;
+}
+
 TServer& TClient::Server() const {
     return mServer;
 }
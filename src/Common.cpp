@@ -113,19 +113,21 @@ bool Application::IsOutdated(const Version& Current, const Version& Newest) {
 }
 
 bool Application::IsShuttingDown() {
-    std::shared_lock Lock(mShutdownMtx);
-    return mShutdown;
+    return mShutdown.load(std::memory_order_acquire);
+}
+
+void Application::WaitForShutdown() {
+    std::unique_lock Lock(mShutdownWaitMutex);
+    mShutdownWaitCondition.wait(Lock, [] { return IsShuttingDown(); });
+}
+
+bool Application::SleepUntilShutdown(std::chrono::steady_clock::duration Timeout) {
+    std::unique_lock Lock(mShutdownWaitMutex);
+    return mShutdownWaitCondition.wait_for(Lock, Timeout, [] { return IsShuttingDown(); });
 }
 
 void Application::SleepSafeSeconds(size_t Seconds) {
-    // Sleeps for 500 ms, checks if a shutdown occurred, and so forth
-    for (size_t i = 0; i < Seconds * 2; ++i) {
-        if (Application::IsShuttingDown()) {
-            return;
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-        }
-    }
+    SleepUntilShutdown(std::chrono::seconds(Seconds));
 }
 
 TEST_CASE("Application::IsOutdated (version check)") {
@@ -196,8 +198,61 @@ void Application::SetSubsystemStatus(const std::string& Subsystem, Status status
 }
 
 void Application::SetShutdown(bool Val) {
-    std::unique_lock Lock(mShutdownMtx);
-    mShutdown = Val;
+    mShutdown.store(Val, std::memory_order_release);
+    if (Val) {
+        mShutdownSource.request_stop();
+    }
+    // wake up everyone waiting for shutdown, so they can exit. Locking the mutexes
+    // makes sure that nobody is between checking the flag and going to sleep.
+    {
+        std::unique_lock Lock(mShutdownWaitMutex);
+    }
+    mShutdownWaitCondition.notify_all();
+    {
+        std::unique_lock Lock(mPublicStateMutex);
+    }
+    mPublicStateCondition.notify_all();
+}
+
+uint64_t Application::PublicStateVersion() {
+    std::unique_lock Lock(mPublicStateMutex);
+    return mPublicStateVersion;
+}
+
+void Application::NotifyPublicStateChanged() {
+    {
+        std::unique_lock Lock(mPublicStateMutex);
+        ++mPublicStateVersion;
+    }
+    mPublicStateCondition.notify_all();
+}
+
+void Application::WaitForPublicStateChange(uint64_t Seen, std::chrono::steady_clock::duration Timeout) {
+    std::unique_lock Lock(mPublicStateMutex);
+    mPublicStateCondition.wait_for(Lock, Timeout, [Seen] {
+        return mPublicStateVersion != Seen || IsShuttingDown();
+    });
+}
+
+TEST_CASE("Application::WaitForPublicStateChange") {
+    SUBCASE("Wakes up on change") {
+        const auto Seen = Application::PublicStateVersion();
+        std::thread Notifier([] {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            Application::NotifyPublicStateChanged();
+        });
+        const auto Start = std::chrono::steady_clock::now();
+        Application::WaitForPublicStateChange(Seen, std::chrono::seconds(30));
+        CHECK(std::chrono::steady_clock::now() - Start < std::chrono::seconds(10));
+        CHECK_NE(Application::PublicStateVersion(), Seen);
+        Notifier.join();
+    }
+    SUBCASE("Times out without change") {
+        const auto Seen = Application::PublicStateVersion();
+        const auto Start = std::chrono::steady_clock::now();
+        Application::WaitForPublicStateChange(Seen, std::chrono::milliseconds(20));
+        CHECK(std::chrono::steady_clock::now() - Start >= std::chrono::milliseconds(20));
+    }
 }
 
 TEST_CASE("Application::SetSubsystemStatus") {
@@ -253,15 +308,13 @@ void Application::CheckForUpdates() {
 
 static std::map<std::thread::id, std::string> threadNameMap {};
 static std::mutex ThreadNameMapMutex {};
+// this thread's name as ThreadName() returns it, so that logging doesn't
+// need to lock the map
+static thread_local std::string CachedThreadName {};
 
 std::string ThreadName(bool DebugModeOverride) {
-    auto Lock = std::unique_lock(ThreadNameMapMutex);
     if (DebugModeOverride || Application::Settings.getAsBool(Settings::Key::General_Debug)) {
-        auto id = std::this_thread::get_id();
-        if (threadNameMap.find(id) != threadNameMap.end()) {
-            // found
-            return threadNameMap.at(id) + " ";
-        }
+        return CachedThreadName;
     }
     return "";
 }
@@ -300,6 +353,7 @@ void RegisterThread(const std::string& str) {
         std::ofstream ThreadFile(".Threads.log", std::ios::app);
         ThreadFile << ("Thread \"" + str + "\" is TID " + ThreadId) << std::endl;
     }
+    CachedThreadName = str + " ";
     auto Lock = std::unique_lock(ThreadNameMapMutex);
     threadNameMap[std::this_thread::get_id()] = str;
 }
@@ -307,6 +361,16 @@ void RegisterThread(const std::string& str) {
 TEST_CASE("RegisterThread") {
     RegisterThread("MyThread");
     CHECK(threadNameMap.at(std::this_thread::get_id()) == "MyThread");
+    SUBCASE("Names are per thread") {
+        std::string OtherName;
+        std::thread Other([&] {
+            RegisterThread("OtherThread");
+            OtherName = ThreadName(true);
+        });
+        Other.join();
+        CHECK_EQ(OtherName, "OtherThread ");
+        CHECK_EQ(ThreadName(true), "MyThread ");
+    }
 }
 
 Version::Version(uint8_t major, uint8_t minor, uint8_t patch)
@@ -322,6 +386,13 @@ std::string Version::AsString() {
     return fmt::format("{:d}.{:d}.{:d}", major, minor, patch);
 }
 
+TEST_CASE("FileBasename") {
+    static_assert(std::string_view(FileBasename("src/Common.cpp")) == "Common.cpp");
+    CHECK_EQ(std::string_view(FileBasename("C:\\BeamMP\\src\\Common.cpp")), "Common.cpp");
+    CHECK_EQ(std::string_view(FileBasename("Common.cpp")), "Common.cpp");
+    CHECK_EQ(std::string_view(FileBasename("src/")), "");
+}
+
 TEST_CASE("Version::AsString") {
     CHECK(Version { 0, 0, 0 }.AsString() == "0.0.0");
     CHECK(Version { 1, 2, 3 }.AsString() == "1.2.3");
@@ -388,7 +459,7 @@ static constexpr size_t STARTING_MAX_DECOMPRESSION_BUFFER_SIZE = 15 * 1024 * 102
 static constexpr size_t MAX_DECOMPRESSION_BUFFER_SIZE = 30 * 1024 * 1024;
 
 std::vector<uint8_t> DeComp(std::span<const uint8_t> input) {
-    beammp_debugf("got {} bytes of input data", input.size());
+    beammp_tracef("got {} bytes of input data", input.size());
 
     // start with a decompression buffer of 5x the input size, clamped to a maximum of 15 MB.
     // this buffer can and will grow, but we don't want to start it too large. A 5x compression ratio
@@ -444,7 +515,7 @@ std::vector<uint8_t> Comp(std::span<const uint8_t> input) {
         beammp_error("zlib compress() failed: " + std::to_string(res));
         throw std::runtime_error("zlib compress() failed");
     }
-    beammp_debug("zlib compressed " + std::to_string(input.size()) + " B to " + std::to_string(output_size) + " B");
+    beammp_tracef("zlib compressed {} B to {} B", input.size(), output_size);
     output.resize(output_size);
     return output;
 }
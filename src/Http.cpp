@@ -24,46 +24,97 @@
 #include "LuaAPI.h"
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <random>
+#include <set>
 #include <stdexcept>
+#include <thread>
 
 using json = nlohmann::json;
-struct Connection {
-    std::string host {};
-    int port {};
-    Connection() = default;
-    Connection(std::string host, int port)
-        : host(host)
-        , port(port) {};
-};
-constexpr uint8_t CONNECTION_AMOUNT = 10;
-static thread_local uint8_t write_index = 0;
-static thread_local std::array<Connection, CONNECTION_AMOUNT> connections;
-static thread_local std::array<std::shared_ptr<httplib::SSLClient>, CONNECTION_AMOUNT> clients;
-
-[[nodiscard]] static std::shared_ptr<httplib::SSLClient> getClient(Connection connectionInfo) {
-    for (uint8_t i = 0; i < CONNECTION_AMOUNT; i++) {
-        if (connectionInfo.host == connections[i].host
-            && connectionInfo.port == connections[i].port) {
-            beammp_tracef("Old client reconnected, with ip {} and port {}", connectionInfo.host, connectionInfo.port);
-            return clients[i];
+
+namespace {
+// Idle keep-alive connections, by origin. A client is only used by one request
+// at a time, and only goes back into the pool if that request went through.
+class ClientPool {
+public:
+    std::unique_ptr<httplib::Client> Acquire(const std::string& Origin, bool& Reused) {
+        {
+            std::unique_lock Lock(mMutex);
+            auto& Idle = mIdle[Origin];
+            if (!Idle.empty()) {
+                auto Client = std::move(Idle.back());
+                Idle.pop_back();
+                Reused = true;
+                beammp_tracef("Reusing connection to {}", Origin);
+                return Client;
+            }
+        }
+        Reused = false;
+        beammp_tracef("New connection to {}", Origin);
+        auto Client = std::make_unique<httplib::Client>(Origin);
+        Client->set_keep_alive(true);
+        Client->enable_server_certificate_verification(false);
+        Client->set_address_family(AF_INET);
+        return Client;
+    }
+
+    void Release(const std::string& Origin, std::unique_ptr<httplib::Client> Client) {
+        std::unique_lock Lock(mMutex);
+        auto& Idle = mIdle[Origin];
+        if (Idle.size() < MaxIdlePerOrigin) {
+            Idle.push_back(std::move(Client));
         }
     }
-    uint8_t i = write_index;
-    write_index++;
-    write_index %= CONNECTION_AMOUNT;
-    clients[i] = std::make_shared<httplib::SSLClient>(connectionInfo.host, connectionInfo.port);
-    connections[i] = { connectionInfo.host, connectionInfo.port };
-    beammp_tracef("New client connected, with ip {} and port {}", connectionInfo.host, connectionInfo.port);
-    return clients[i];
+
+private:
+    static constexpr size_t MaxIdlePerOrigin = 8;
+    std::mutex mMutex;
+    std::unordered_map<std::string, std::vector<std::unique_ptr<httplib::Client>>> mIdle;
+};
+
+ClientPool& Pool() {
+    static ClientPool Instance;
+    return Instance;
+}
+
+std::string OriginOf(const std::string& host, int port) {
+    return "https://" + host + ":" + std::to_string(port);
+}
+
+// what httplib uses unless told otherwise
+constexpr auto DefaultReadTimeout = std::chrono::seconds(CPPHTTPLIB_READ_TIMEOUT_SECOND);
+
+// Runs Request with a pooled client. The timeout is set for every request, as
+// pooled clients are shared between all kinds of requests. A reused connection
+// may have been closed by the other side in the meantime, so if the request
+// couldn't even be sent on one, it's retried once on a new connection. Anything
+// that fails later (e.g. a read timeout) isn't retried, the backend may already
+// be handling the request, and it'd only double the wait.
+template <typename RequestFn>
+httplib::Result WithPooledClient(const std::string& Origin, std::chrono::seconds ReadTimeout, RequestFn&& Request) {
+    bool Reused = false;
+    auto Client = Pool().Acquire(Origin, Reused);
+    Client->set_read_timeout(ReadTimeout);
+    auto Result = Request(*Client);
+    if (!Result && Reused && Result.error() == httplib::Error::Write) {
+        beammp_debugf("Request on reused connection to {} failed ({}), retrying", Origin, httplib::to_string(Result.error()));
+        Client = Pool().Acquire(Origin, Reused);
+        Client->set_read_timeout(ReadTimeout);
+        Result = Request(*Client);
+    }
+    if (Result) {
+        Pool().Release(Origin, std::move(Client));
+    }
+    return Result;
+}
 }
 
 std::string Http::GET(const std::string& host, int port, const std::string& target, unsigned int* status) {
-    std::shared_ptr<httplib::SSLClient> client = getClient({ host, port });
-    client->enable_server_certificate_verification(false);
-    client->set_address_family(AF_INET);
-    auto res = client->Get(target.c_str());
+    auto res = WithPooledClient(OriginOf(host, port), DefaultReadTimeout, [&](httplib::Client& client) {
+        return client.Get(target.c_str());
+    });
     if (res) {
         if (status) {
             *status = res->status;
@@ -75,12 +126,9 @@ std::string Http::GET(const std::string& host, int port, const std::string& targ
 }
 
 std::string Http::POST(const std::string& host, int port, const std::string& target, const std::string& body, const std::string& ContentType, unsigned int* status, const httplib::Headers& headers) {
-    std::shared_ptr<httplib::SSLClient> client = getClient({ host, port });
-    client->set_read_timeout(std::chrono::seconds(10));
-    beammp_assert(client->is_valid());
-    client->enable_server_certificate_verification(false);
-    client->set_address_family(AF_INET);
-    auto res = client->Post(target.c_str(), headers, body.c_str(), body.size(), ContentType.c_str());
+    auto res = WithPooledClient(OriginOf(host, port), std::chrono::seconds(10), [&](httplib::Client& client) {
+        return client.Post(target.c_str(), headers, body.c_str(), body.size(), ContentType.c_str());
+    });
     if (res) {
         if (status) {
             *status = res->status;
@@ -92,6 +140,76 @@ std::string Http::POST(const std::string& host, int port, const std::string& tar
     }
 }
 
+Http::Response Http::POSTToOrigin(const std::string& Origin, const std::string& target, const std::string& body, const std::string& ContentType, const httplib::Headers& headers) {
+    auto res = WithPooledClient(Origin, std::chrono::seconds(10), [&](httplib::Client& client) {
+        return client.Post(target.c_str(), headers, body.c_str(), body.size(), ContentType.c_str());
+    });
+    if (!res) {
+        beammp_debug("POST failed: " + httplib::to_string(res.error()));
+        return {};
+    }
+    return { res->status, res->body };
+}
+
+TEST_CASE("Http::POSTToOrigin") {
+    httplib::Server Server;
+    std::mutex ConnectionsMutex;
+    std::set<int> Connections;
+    Server.Post("/echo", [&](const httplib::Request& req, httplib::Response& res) {
+        {
+            std::unique_lock Lock(ConnectionsMutex);
+            Connections.insert(req.remote_port);
+        }
+        res.set_content(req.body, "text/plain");
+    });
+    Server.set_keep_alive_max_count(100);
+    const int Port = Server.bind_to_any_port("127.0.0.1");
+    REQUIRE(Port > 0);
+    std::thread ServerThread([&] { Server.listen_after_bind(); });
+    while (!Server.is_running()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const std::string Origin = "http://127.0.0.1:" + std::to_string(Port);
+
+    SUBCASE("Sequential requests share one connection") {
+        for (int i = 0; i < 5; ++i) {
+            auto Res = Http::POSTToOrigin(Origin, "/echo", std::to_string(i), "text/plain");
+            CHECK_EQ(Res.Status, 200);
+            CHECK_EQ(Res.Body, std::to_string(i));
+        }
+        std::unique_lock Lock(ConnectionsMutex);
+        CHECK_EQ(Connections.size(), 1);
+    }
+    SUBCASE("Concurrent requests") {
+        constexpr int Threads = 16;
+        std::vector<Http::Response> Responses(Threads);
+        std::vector<std::thread> Workers;
+        for (int i = 0; i < Threads; ++i) {
+            Workers.emplace_back([&, i] {
+                Responses[size_t(i)] = Http::POSTToOrigin(Origin, "/echo", std::to_string(i), "text/plain");
+            });
+        }
+        for (auto& Worker : Workers) {
+            Worker.join();
+        }
+        for (int i = 0; i < Threads; ++i) {
+            CHECK_EQ(Responses[size_t(i)].Status, 200);
+            CHECK_EQ(Responses[size_t(i)].Body, std::to_string(i));
+        }
+        // at most one connection per request in flight
+        std::unique_lock Lock(ConnectionsMutex);
+        CHECK(Connections.size() <= size_t(Threads));
+    }
+    SUBCASE("Server gone") {
+        Server.stop();
+        auto Res = Http::POSTToOrigin(Origin, "/echo", "hello", "text/plain");
+        CHECK_EQ(Res.Status, 0);
+    }
+
+    Server.stop();
+    ServerThread.join();
+}
+
 // RFC 2616, RFC 7231
 static std::map<size_t, const char*> Map = {
     { -1, "Invalid Response Code" },
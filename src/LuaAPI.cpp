@@ -246,7 +246,7 @@ std::pair<bool, std::string> LuaAPI::MP::RemoveVehicle(int PID, int VID) {
         return Result;
     }
     auto c = MaybeClient.value().lock();
-    if (!c->GetCarData(VID).empty()) {
+    if (c->GetCarData(VID)) {
         std::string Destroy = "Od:" + std::to_string(PID) + "-" + std::to_string(VID);
         LuaAPI::MP::Engine->ReportErrors(LuaAPI::MP::Engine->TriggerEvent("onVehicleDeleted", "", PID, VID));
         Engine->Network().SendToAll(nullptr, StringToVector(Destroy), true, true);
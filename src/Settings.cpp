@@ -17,6 +17,7 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "Settings.h"
+#include "Common.h"
 
 Settings::Settings() {
     SettingsMap = std::unordered_map<Key, SettingsTypeVariant> {
@@ -37,7 +38,17 @@ Settings::Settings() {
         { Misc_SendErrorsShowMessage, true },
         { Misc_SendErrors, true },
         { Misc_ImScaredOfUpdates, true },
-        { Misc_UpdateReminderTime, "30s" }
+        { Misc_UpdateReminderTime, "30s" },
+        { Misc_CompactVehicleConfigs, false },
+        { Misc_MaxConcurrentAuths, 16 },
+        { Misc_MaxConcurrentResourceSyncs, 0 },
+        { Misc_MaxConcurrentWorldSyncs, 4 },
+        { Misc_AuthCacheSeconds, 0 },
+        { Misc_LogSyncIntervalSeconds, 5 },
+        { Misc_LogRotateSizeMB, 100 },
+        { Misc_LogRotateHours, 0 },
+        { Misc_LogArchivesKept, 5 },
+        { Misc_EventJournalRecords, 0 }
     };
 
     InputAccessMapping = std::unordered_map<ComposedKey, SettingsAccessControl> {
@@ -57,39 +68,36 @@ Settings::Settings() {
         { { "Misc", "SendErrorsShowMessage" }, { Misc_SendErrorsShowMessage, READ_WRITE } },
         { { "Misc", "SendErrors" }, { Misc_SendErrors, READ_WRITE } },
         { { "Misc", "ImScaredOfUpdates" }, { Misc_ImScaredOfUpdates, READ_WRITE } },
-        { { "Misc", "UpdateReminderTime" }, { Misc_UpdateReminderTime, READ_WRITE } }
+        { { "Misc", "UpdateReminderTime" }, { Misc_UpdateReminderTime, READ_WRITE } },
+        { { "Misc", "CompactVehicleConfigs" }, { Misc_CompactVehicleConfigs, READ_WRITE } },
+        { { "Misc", "MaxConcurrentAuths" }, { Misc_MaxConcurrentAuths, READ_WRITE } },
+        { { "Misc", "MaxConcurrentResourceSyncs" }, { Misc_MaxConcurrentResourceSyncs, READ_WRITE } },
+        { { "Misc", "MaxConcurrentWorldSyncs" }, { Misc_MaxConcurrentWorldSyncs, READ_WRITE } },
+        { { "Misc", "AuthCacheSeconds" }, { Misc_AuthCacheSeconds, READ_WRITE } },
+        { { "Misc", "LogSyncIntervalSeconds" }, { Misc_LogSyncIntervalSeconds, READ_WRITE } },
+        { { "Misc", "LogRotateSizeMB" }, { Misc_LogRotateSizeMB, READ_WRITE } },
+        { { "Misc", "LogRotateHours" }, { Misc_LogRotateHours, READ_WRITE } },
+        { { "Misc", "LogArchivesKept" }, { Misc_LogArchivesKept, READ_WRITE } },
+        { { "Misc", "EventJournalRecords" }, { Misc_EventJournalRecords, READ_ONLY } }
     };
+
+    storeSnapshot(*SettingsMap.synchronize());
 }
 
 std::string Settings::getAsString(Key key) {
-    auto map = SettingsMap.synchronize();
-    if (!map->contains(key)) {
-        throw std::logic_error { "Undefined key accessed in Settings::getAsString" };
-    }
-    return std::get<std::string>(map->at(key));
+    return snapshot().getAsString(key);
 }
+
 int Settings::getAsInt(Key key) {
-    auto map = SettingsMap.synchronize();
-    if (!map->contains(key)) {
-        throw std::logic_error { "Undefined key accessed in Settings::getAsInt" };
-    }
-    return std::get<int>(map->at(key));
+    return snapshot().getAsInt(key);
 }
 
 bool Settings::getAsBool(Key key) {
-    auto map = SettingsMap.synchronize();
-    if (!map->contains(key)) {
-        throw std::logic_error { "Undefined key accessed in Settings::getAsBool" };
-    }
-    return std::get<bool>(map->at(key));
+    return snapshot().getAsBool(key);
 }
 
 Settings::SettingsTypeVariant Settings::get(Key key) {
-    auto map = SettingsMap.synchronize();
-    if (!map->contains(key)) {
-        throw std::logic_error { "Undefined setting key accessed in Settings::get" };
-    }
-    return map->at(key);
+    return snapshot().get(key);
 }
 
 void Settings::set(Key key, const std::string& value) {
@@ -101,6 +109,34 @@ void Settings::set(Key key, const std::string& value) {
         throw std::logic_error { fmt::format("Wrong value type in Settings::set(std::string): index {}", map->at(key).index()) };
     }
     map->at(key) = value;
+    publish(*map);
+}
+
+void Settings::storeSnapshot(const std::unordered_map<Key, SettingsTypeVariant>& map) {
+    auto New = std::make_unique<Snapshot>();
+    for (const auto& [key, value] : map) {
+        New->Values[key] = value;
+    }
+    mSnapshot.store(New.get(), std::memory_order_release);
+    mSnapshots.push_back(std::move(New));
+}
+
+void Settings::publish(const std::unordered_map<Key, SettingsTypeVariant>& map) {
+    storeSnapshot(map);
+    Application::NotifyPublicStateChanged();
+    for (const auto& [id, listener] : *mChangeListeners.synchronize()) {
+        listener();
+    }
+}
+
+size_t Settings::addChangeListener(std::function<void()> listener) {
+    const auto id = mNextChangeListener++;
+    mChangeListeners->emplace(id, std::move(listener));
+    return id;
+}
+
+void Settings::removeChangeListener(size_t id) {
+    mChangeListeners->erase(id);
 }
 
 const std::unordered_map<ComposedKey, Settings::SettingsAccessControl> Settings::getAccessControlMap() const {
@@ -134,6 +170,7 @@ void Settings::setConsoleInputAccessMapping(const ComposedKey& keyName, const st
     }
 
     map->at(key) = value;
+    publish(*map);
 }
 
 void Settings::setConsoleInputAccessMapping(const ComposedKey& keyName, int value) {
@@ -153,6 +190,7 @@ void Settings::setConsoleInputAccessMapping(const ComposedKey& keyName, int valu
     }
 
     map->at(key) = value;
+    publish(*map);
 }
 
 void Settings::setConsoleInputAccessMapping(const ComposedKey& keyName, bool value) {
@@ -172,6 +210,7 @@ void Settings::setConsoleInputAccessMapping(const ComposedKey& keyName, bool val
     }
 
     map->at(key) = value;
+    publish(*map);
 }
 
 TEST_CASE("settings get/set") {
@@ -184,6 +223,33 @@ TEST_CASE("settings get/set") {
     CHECK_EQ(settings.getAsInt(Settings::General_MaxPlayers), 12);
 }
 
+TEST_CASE("settings snapshot") {
+    Settings settings;
+    settings.set(Settings::General_MaxPlayers, 8);
+    const auto& Before = settings.snapshot();
+    settings.set(Settings::General_MaxPlayers, 12);
+    settings.set(Settings::General_Name, "changed");
+    // a snapshot never changes once taken
+    CHECK_EQ(Before.getAsInt(Settings::General_MaxPlayers), 8);
+    CHECK_NE(Before.getAsString(Settings::General_Name), "changed");
+    const auto& After = settings.snapshot();
+    CHECK_EQ(After.getAsInt(Settings::General_MaxPlayers), 12);
+    CHECK_EQ(After.getAsString(Settings::General_Name), "changed");
+    CHECK_THROWS(After.getAsBool(Settings::General_MaxPlayers));
+}
+
+TEST_CASE("settings change listeners") {
+    Settings settings;
+    int calls = 0;
+    const auto id = settings.addChangeListener([&] { ++calls; });
+    settings.set(Settings::General_MaxPlayers, 12);
+    settings.set(Settings::General_Debug, true);
+    CHECK_EQ(calls, 2);
+    settings.removeChangeListener(id);
+    settings.set(Settings::General_MaxPlayers, 13);
+    CHECK_EQ(calls, 2);
+}
+
 TEST_CASE("settings check for exception on wrong input type") {
     Settings settings;
     CHECK_THROWS(settings.set(Settings::General_Debug, "hello, world"));
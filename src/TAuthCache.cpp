@@ -0,0 +1,122 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "TAuthCache.h"
+
+#include "Common.h"
+#include <algorithm>
+
+static std::string CacheKey(const std::string& Key, const std::string& IP) {
+    // the key comes straight from the client and may contain anything, so the
+    // IP is length-prefixed instead of relying on a separator the key can't hold
+    return std::to_string(IP.size()) + ':' + IP + Key;
+}
+
+TAuthCache::TAuthCache(std::function<std::chrono::seconds()> TTL, size_t Capacity)
+    : mTTL(std::move(TTL))
+    , mCapacity(Capacity) {
+}
+
+std::optional<TAuthInfo> TAuthCache::Find(const std::string& Key, const std::string& IP) {
+    if (mTTL() <= std::chrono::seconds(0)) {
+        return std::nullopt;
+    }
+    std::unique_lock Lock(mMutex);
+    auto Iter = mEntries.find(CacheKey(Key, IP));
+    if (Iter == mEntries.end() || Iter->second.Expiry <= Clock::now()) {
+        ++mMisses;
+        return std::nullopt;
+    }
+    ++mHits;
+    return Iter->second.Info;
+}
+
+void TAuthCache::Insert(const std::string& Key, const std::string& IP, TAuthInfo Info) {
+    const auto TTL = mTTL();
+    if (TTL <= std::chrono::seconds(0)) {
+        return;
+    }
+    const auto Now = Clock::now();
+    std::unique_lock Lock(mMutex);
+    if (mEntries.size() >= mCapacity) {
+        EvictLocked(Now);
+    }
+    mEntries.insert_or_assign(CacheKey(Key, IP), TEntry { std::move(Info), Now + TTL, mNextSequence++ });
+}
+
+TAuthCache::TStats TAuthCache::Stats() const {
+    std::unique_lock Lock(mMutex);
+    return TStats {
+        .Entries = mEntries.size(),
+        .Hits = mHits,
+        .Misses = mMisses,
+    };
+}
+
+void TAuthCache::EvictLocked(Clock::time_point Now) {
+    std::erase_if(mEntries, [Now](const auto& Pair) { return Pair.second.Expiry <= Now; });
+    while (!mEntries.empty() && mEntries.size() >= mCapacity) {
+        auto Oldest = std::min_element(mEntries.begin(), mEntries.end(), [](const auto& A, const auto& B) {
+            return A.second.Sequence < B.second.Sequence;
+        });
+        mEntries.erase(Oldest);
+    }
+}
+
+TEST_CASE("TAuthCache") {
+    auto TTL = std::chrono::seconds(60);
+    TAuthCache Cache([&TTL] { return TTL; }, 2);
+    TAuthInfo Info { .Name = "Player", .Roles = "USER", .IsGuest = false, .Identifiers = { { "beammp", "1234" } } };
+
+    SUBCASE("Hit and miss") {
+        CHECK_FALSE(Cache.Find("key", "1.2.3.4").has_value());
+        Cache.Insert("key", "1.2.3.4", Info);
+        auto Found = Cache.Find("key", "1.2.3.4");
+        REQUIRE(Found.has_value());
+        CHECK_EQ(Found->Name, "Player");
+        CHECK_EQ(Found->Identifiers, Info.Identifiers);
+        // same key from another IP is not the same player
+        CHECK_FALSE(Cache.Find("key", "5.6.7.8").has_value());
+        const auto Stats = Cache.Stats();
+        CHECK_EQ(Stats.Hits, 1);
+        CHECK_EQ(Stats.Misses, 2);
+        CHECK_EQ(Stats.Entries, 1);
+    }
+    SUBCASE("Disabled") {
+        TTL = std::chrono::seconds(0);
+        Cache.Insert("key", "1.2.3.4", Info);
+        CHECK_FALSE(Cache.Find("key", "1.2.3.4").has_value());
+        CHECK_EQ(Cache.Stats().Entries, 0);
+        CHECK_EQ(Cache.Stats().Misses, 0);
+    }
+    SUBCASE("Bounded") {
+        Cache.Insert("a", "ip", Info);
+        Cache.Insert("b", "ip", Info);
+        Cache.Insert("c", "ip", Info);
+        CHECK_EQ(Cache.Stats().Entries, 2);
+        CHECK_FALSE(Cache.Find("a", "ip").has_value());
+        CHECK(Cache.Find("c", "ip").has_value());
+    }
+    SUBCASE("Key and IP don't bleed into each other") {
+        Cache.Insert("a\nb", "c", Info);
+        CHECK_FALSE(Cache.Find("a", "b\nc").has_value());
+        CHECK_FALSE(Cache.Find("a\n", "b\nc").has_value());
+        CHECK(Cache.Find("a\nb", "c").has_value());
+    }
+}
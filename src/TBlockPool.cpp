@@ -0,0 +1,74 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "TBlockPool.h"
+
+#include "Common.h"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+TEST_CASE("TBlockPool") {
+    using Pool = TBlockPool<48, 16>;
+
+    SUBCASE("Freed blocks are handed out again") {
+        void* First = Pool::Allocate();
+        CHECK(reinterpret_cast<uintptr_t>(First) % 16 == 0);
+        Pool::Deallocate(First);
+        void* Second = Pool::Allocate();
+        CHECK(Second == First);
+        Pool::Deallocate(Second);
+    }
+    SUBCASE("Blocks freed on one thread are reused by another") {
+        std::vector<void*> Blocks;
+        std::thread([&Blocks] {
+            for (size_t i = 0; i < 4 * Pool::MagazineSize; ++i) {
+                Blocks.push_back(Pool::Allocate());
+            }
+        }).join();
+        const std::unordered_set<void*> Allocated(Blocks.begin(), Blocks.end());
+        // the freeing thread exits, so all of its blocks end up in the depot
+        std::thread([Moved = std::move(Blocks)] {
+            for (void* Block : Moved) {
+                Pool::Deallocate(Block);
+            }
+        }).join();
+        std::vector<void*> Reused;
+        std::thread([&Reused] {
+            for (size_t i = 0; i < Pool::MagazineSize; ++i) {
+                Reused.push_back(Pool::Allocate());
+            }
+        }).join();
+        CHECK(std::all_of(Reused.begin(), Reused.end(), [&Allocated](void* Block) { return Allocated.contains(Block); }));
+        for (void* Block : Reused) {
+            Pool::Deallocate(Block);
+        }
+    }
+    SUBCASE("TPoolAllocator") {
+        auto First = std::allocate_shared<std::vector<int>>(TPoolAllocator<std::vector<int>> {}, 3, 7);
+        CHECK(*First == std::vector<int>({ 7, 7, 7 }));
+        const void* Address = First.get();
+        First.reset();
+        auto Second = std::allocate_shared<std::vector<int>>(TPoolAllocator<std::vector<int>> {});
+        CHECK(static_cast<const void*>(Second.get()) == Address);
+        CHECK(Second->empty());
+    }
+}
@@ -63,6 +63,16 @@ static constexpr std::string_view StrSendErrors = "SendErrors";
 static constexpr std::string_view StrSendErrorsMessageEnabled = "SendErrorsShowMessage";
 static constexpr std::string_view StrHideUpdateMessages = "ImScaredOfUpdates";
 static constexpr std::string_view StrUpdateReminderTime = "UpdateReminderTime";
+static constexpr std::string_view StrCompactVehicleConfigs = "CompactVehicleConfigs";
+static constexpr std::string_view StrMaxConcurrentAuths = "MaxConcurrentAuths";
+static constexpr std::string_view StrMaxConcurrentResourceSyncs = "MaxConcurrentResourceSyncs";
+static constexpr std::string_view StrMaxConcurrentWorldSyncs = "MaxConcurrentWorldSyncs";
+static constexpr std::string_view StrAuthCacheSeconds = "AuthCacheSeconds";
+static constexpr std::string_view StrLogSyncIntervalSeconds = "LogSyncIntervalSeconds";
+static constexpr std::string_view StrLogRotateSizeMB = "LogRotateSizeMB";
+static constexpr std::string_view StrLogRotateHours = "LogRotateHours";
+static constexpr std::string_view StrLogArchivesKept = "LogArchivesKept";
+static constexpr std::string_view StrEventJournalRecords = "EventJournalRecords";
 
 TEST_CASE("TConfig::TConfig") {
     const std::string CfgFile = "beammp_server_testconfig.toml";
@@ -154,6 +164,26 @@ void TConfig::FlushToFile() {
     SetComment(data["Misc"][StrSendErrors.data()].comments(), " If SendErrors is `true`, the server will send helpful info about crashes and other issues back to the BeamMP developers. This info may include your config, who is on your server at the time of the error, and similar general information. This kind of data is vital in helping us diagnose and fix issues faster. This has no impact on server performance. You can opt-out of this system by setting this to `false`");
     data["Misc"][StrSendErrorsMessageEnabled.data()] = Application::Settings.getAsBool(Settings::Key::Misc_SendErrorsShowMessage);
     SetComment(data["Misc"][StrSendErrorsMessageEnabled.data()].comments(), " You can turn on/off the SendErrors message you get on startup here");
+    data["Misc"][StrCompactVehicleConfigs.data()] = Application::Settings.getAsBool(Settings::Key::Misc_CompactVehicleConfigs);
+    SetComment(data["Misc"][StrCompactVehicleConfigs.data()].comments(), " Keeps vehicle configs compressed in memory, and stores identical configs spawned by different players only once. Saves memory on servers with many (modded) vehicles, at the cost of CPU time whenever a vehicle is edited or synced to a joining player.");
+    data["Misc"][StrMaxConcurrentAuths.data()] = Application::Settings.getAsInt(Settings::Key::Misc_MaxConcurrentAuths);
+    SetComment(data["Misc"][StrMaxConcurrentAuths.data()].comments(), " How many joining players may be authenticated with the backend at the same time. Others wait in line. 0 means no limit.");
+    data["Misc"][StrAuthCacheSeconds.data()] = Application::Settings.getAsInt(Settings::Key::Misc_AuthCacheSeconds);
+    SetComment(data["Misc"][StrAuthCacheSeconds.data()].comments(), " For how many seconds a player's authentication is remembered, so that reconnecting with the same key from the same IP skips the authentication backend. 0 disables this.");
+    data["Misc"][StrMaxConcurrentResourceSyncs.data()] = Application::Settings.getAsInt(Settings::Key::Misc_MaxConcurrentResourceSyncs);
+    SetComment(data["Misc"][StrMaxConcurrentResourceSyncs.data()].comments(), " How many joining players may download mods at the same time. Others wait in line. 0 means no limit.");
+    data["Misc"][StrMaxConcurrentWorldSyncs.data()] = Application::Settings.getAsInt(Settings::Key::Misc_MaxConcurrentWorldSyncs);
+    SetComment(data["Misc"][StrMaxConcurrentWorldSyncs.data()].comments(), " How many joining players may be sent the existing vehicles at the same time. Others wait in line. 0 means no limit.");
+    data["Misc"][StrLogSyncIntervalSeconds.data()] = Application::Settings.getAsInt(Settings::Key::Misc_LogSyncIntervalSeconds);
+    SetComment(data["Misc"][StrLogSyncIntervalSeconds.data()].comments(), " How often, in seconds, the log file is synced to disk while the server is logging. Lower values lose fewer log lines if the machine crashes, at the cost of more disk writes. 0 syncs after every write.");
+    data["Misc"][StrLogRotateSizeMB.data()] = Application::Settings.getAsInt(Settings::Key::Misc_LogRotateSizeMB);
+    SetComment(data["Misc"][StrLogRotateSizeMB.data()].comments(), " Once Server.log reaches this size in MB, it is compressed into a Server.<date>.log.gz archive and a new Server.log is started. 0 disables this.");
+    data["Misc"][StrLogRotateHours.data()] = Application::Settings.getAsInt(Settings::Key::Misc_LogRotateHours);
+    SetComment(data["Misc"][StrLogRotateHours.data()].comments(), " Like LogRotateSizeMB, but starts a new Server.log after this many hours. 0 disables this.");
+    data["Misc"][StrLogArchivesKept.data()] = Application::Settings.getAsInt(Settings::Key::Misc_LogArchivesKept);
+    SetComment(data["Misc"][StrLogArchivesKept.data()].comments(), " How many compressed log archives to keep, older ones are deleted. 0 keeps all of them.");
+    data["Misc"][StrEventJournalRecords.data()] = Application::Settings.getAsInt(Settings::Key::Misc_EventJournalRecords);
+    SetComment(data["Misc"][StrEventJournalRecords.data()].comments(), " For debugging: records every packet sent, received and handled into Server.journal, keeping the newest this many 32-byte records. Decode it with BeamMP-Server-journal. 0 disables this. Takes effect on restart.");
     std::stringstream Ss;
     Ss << "# This is the BeamMP-Server config file.\n"
           "# Help & Documentation: `https://docs.beammp.com/server/server-maintenance/`\n"
@@ -264,6 +294,16 @@ void TConfig::ParseFromFile(std::string_view name) {
         TryReadValue(data, "Misc", StrHideUpdateMessages, "", Settings::Key::Misc_ImScaredOfUpdates);
         TryReadValue(data, "Misc", StrSendErrorsMessageEnabled, "", Settings::Key::Misc_SendErrorsShowMessage);
         TryReadValue(data, "Misc", StrUpdateReminderTime, "", Settings::Key::Misc_UpdateReminderTime);
+        TryReadValue(data, "Misc", StrCompactVehicleConfigs, "", Settings::Key::Misc_CompactVehicleConfigs);
+        TryReadValue(data, "Misc", StrMaxConcurrentAuths, "", Settings::Key::Misc_MaxConcurrentAuths);
+        TryReadValue(data, "Misc", StrMaxConcurrentResourceSyncs, "", Settings::Key::Misc_MaxConcurrentResourceSyncs);
+        TryReadValue(data, "Misc", StrMaxConcurrentWorldSyncs, "", Settings::Key::Misc_MaxConcurrentWorldSyncs);
+        TryReadValue(data, "Misc", StrAuthCacheSeconds, "", Settings::Key::Misc_AuthCacheSeconds);
+        TryReadValue(data, "Misc", StrLogSyncIntervalSeconds, "", Settings::Key::Misc_LogSyncIntervalSeconds);
+        TryReadValue(data, "Misc", StrLogRotateSizeMB, "", Settings::Key::Misc_LogRotateSizeMB);
+        TryReadValue(data, "Misc", StrLogRotateHours, "", Settings::Key::Misc_LogRotateHours);
+        TryReadValue(data, "Misc", StrLogArchivesKept, "", Settings::Key::Misc_LogArchivesKept);
+        TryReadValue(data, "Misc", StrEventJournalRecords, "", Settings::Key::Misc_EventJournalRecords);
 
     } catch (const std::exception& err) {
         beammp_error("Error parsing config file value: " + std::string(err.what()));
@@ -112,13 +112,26 @@ void TConsole::BackupOldLog() {
 }
 
 void TConsole::StartLoggingToFile() {
-    mLogFileStream.open("Server.log");
+    mLogSink = std::make_unique<TLogSink>(
+        "Server.log", 8192,
+        [] {
+            return std::chrono::seconds(Application::Settings.getAsInt(Settings::Key::Misc_LogSyncIntervalSeconds));
+        },
+        [] {
+            const auto& Current = Application::Settings.snapshot();
+            return TLogSink::TRotation {
+                .MaxBytes = size_t(std::max(Current.getAsInt(Settings::Key::Misc_LogRotateSizeMB), 0)) * MB,
+                .MaxAge = std::chrono::hours(std::max(Current.getAsInt(Settings::Key::Misc_LogRotateHours), 0)),
+                .KeepArchives = size_t(std::max(Current.getAsInt(Settings::Key::Misc_LogArchivesKept), 0)),
+            };
+        });
+    if (!mLogSink->IsOpen()) {
+        beammp_errorf("Failed to open log file 'Server.log': {}", GetPlatformAgnosticErrorString());
+        return;
+    }
     Application::Console().Internal().on_write = [this](const std::string& ToWrite) {
         // TODO: Sanitize by removing all ansi escape codes (vt100)
-        std::unique_lock Lock(mLogFileStreamMtx);
-        mLogFileStream.write(ToWrite.c_str(), ToWrite.size());
-        mLogFileStream.write("\n", 1);
-        mLogFileStream.flush();
+        mLogSink->Write(ToWrite);
     };
 }
 
@@ -533,6 +546,8 @@ void TConsole::Command_Status(const std::string&, const std::vector<std::string>
     std::stringstream Status;
 
     size_t CarCount = 0;
+    size_t CarMemoryUsage = 0;
+    size_t CarConfigCount = 0;
     size_t ConnectedCount = 0;
     size_t GuestCount = 0;
     size_t SyncedCount = 0;
@@ -543,6 +558,9 @@ void TConsole::Command_Status(const std::string&, const std::vector<std::string>
         if (!Client.expired()) {
             auto Locked = Client.lock();
             CarCount += Locked->GetCarCount();
+            const auto CarsMemoryUsage = Locked->GetCarsMemoryUsage();
+            CarMemoryUsage += CarsMemoryUsage.Bytes;
+            CarConfigCount += CarsMemoryUsage.Configs;
             ConnectedCount += Locked->IsUDPConnected() ? 1 : 0;
             GuestCount += Locked->IsGuest() ? 1 : 0;
             SyncedCount += Locked->IsSynced() ? 1 : 0;
@@ -601,6 +619,18 @@ void TConsole::Command_Status(const std::string&, const std::vector<std::string>
 
     auto ElapsedTime = mLuaEngine->Server().UptimeTimer.GetElapsedTime();
 
+    std::stringstream JoinStages;
+    const auto& Pipeline = mLuaEngine->Network().JoinPipeline();
+    for (const TJoinStage* Stage : { &Pipeline.Auth, &Pipeline.ResourceSync, &Pipeline.WorldSync }) {
+        const auto Stats = Stage->Stats();
+        JoinStages << "\t\t" << fmt::format("{:<29}", Stage->Name() + ":")
+                   << Stats.Active << "/" << (Stats.Limit > 0 ? std::to_string(Stats.Limit) : "unlimited") << " active, "
+                   << Stats.Queued << " queued (peak " << Stats.PeakQueued << "), "
+                   << Stats.Completed << " done, wait avg/max " << Stats.AverageWait.count() << "/" << Stats.MaxWait.count() << "ms\n";
+    }
+
+    const auto AuthCacheStats = mLuaEngine->Network().AuthCache().Stats();
+
     Status << "BeamMP-Server Status:\n"
            << "\tTotal Players:             " << mLuaEngine->Server().ClientCount() << "\n"
            << "\tSyncing Players:           " << SyncingCount << "\n"
@@ -608,9 +638,19 @@ void TConsole::Command_Status(const std::string&, const std::vector<std::string>
            << "\tConnected Players:         " << ConnectedCount << "\n"
            << "\tGuests:                    " << GuestCount << "\n"
            << "\tCars:                      " << CarCount << "\n"
+           << "\tVehicle configs:\n"
+           << "\t\tMemory used:                 " << CarMemoryUsage / 1024 << " KiB\n"
+           << "\t\tMemory used per vehicle:     " << (CarConfigCount == 0 ? 0 : CarMemoryUsage / CarConfigCount) << " B\n"
+           << "\t\tCompact (deduplicated):      " << TVehicleData::CompactConfigCount() << "\n"
            << "\tUptime:                    " << ElapsedTime << "ms (~" << size_t(double(ElapsedTime) / 1000.0 / 60.0 / 60.0) << "h) \n"
+           << "\tJoin stages:\n"
+           << JoinStages.str()
+           << "\tLog lines dropped:         " << DroppedLogLines() << "\n"
+           << "\tAuth cache:\n"
+           << "\t\tEntries:                     " << AuthCacheStats.Entries << "\n"
+           << "\t\tHits/Misses:                 " << AuthCacheStats.Hits << "/" << AuthCacheStats.Misses << "\n"
            << "\tLua:\n"
-           << "\t\tQueued results to check:     " << mLuaEngine->GetResultsToCheckSize() << "\n"
+           << "\t\tQueued calls:                " << mLuaEngine->GetQueuedWorkCount() << "\n"
            << "\t\tStates:                      " << mLuaEngine->GetLuaStateCount() << "\n"
            << "\t\tEvent timers:                " << mLuaEngine->GetTimedEventsCount() << "\n"
            << "\t\tEvent handlers:              " << mLuaEngine->GetRegisteredEventHandlerCount() << "\n"
@@ -677,31 +717,9 @@ void TConsole::HandleLuaInternalCommand(const std::string& cmd) {
     if (cmd == "exit") {
         ChangeToRegularConsole();
     } else if (cmd == "queued") {
-        auto QueuedFunctions = LuaAPI::MP::Engine->Debug_GetStateFunctionQueueForState(mStateId);
-        Application::Console().WriteRaw("Pending functions in State '" + mStateId + "'");
-        std::unordered_map<std::string, size_t> FunctionsCount;
-        std::vector<std::string> FunctionsInOrder;
-        while (!QueuedFunctions.empty()) {
-            auto Tuple = QueuedFunctions.front();
-            QueuedFunctions.erase(QueuedFunctions.begin());
-            FunctionsInOrder.push_back(Tuple.FunctionName);
-            FunctionsCount[Tuple.FunctionName] += 1;
-        }
-        std::set<std::string> Uniques;
-        for (const auto& Function : FunctionsInOrder) {
-            if (Uniques.count(Function) == 0) {
-                Uniques.insert(Function);
-                if (FunctionsCount.at(Function) > 1) {
-                    Application::Console().WriteRaw("    " + Function + " (" + std::to_string(FunctionsCount.at(Function)) + "x)");
-                } else {
-                    Application::Console().WriteRaw("    " + Function);
-                }
-            }
-        }
-        Application::Console().WriteRaw("Executed functions waiting to be checked in State '" + mStateId + "'");
-        for (const auto& Function : LuaAPI::MP::Engine->Debug_GetResultsToCheckForState(mStateId)) {
-            Application::Console().WriteRaw("    '" + Function.Function + "' (Ready? " + (Function.Ready ? "Yes" : "No") + ", Error? " + (Function.Error ? "Yes: '" + Function.ErrorMessage + "'" : "No") + ")");
-        }
+        // the queue is lock-free, so only its size can be looked at from here
+        auto Queued = LuaAPI::MP::Engine->Debug_GetStateFunctionQueueSizeForState(mStateId);
+        Application::Console().WriteRaw("Queued calls in State '" + mStateId + "': " + std::to_string(Queued));
     } else if (cmd == "events") {
         auto Events = LuaAPI::MP::Engine->Debug_GetEventsForState(mStateId);
         Application::Console().WriteRaw("Registered Events + Handlers for State '" + mStateId + "'");
@@ -711,6 +729,14 @@ void TConsole::HandleLuaInternalCommand(const std::string& cmd) {
                 Application::Console().WriteRaw("        " + Handler);
             }
         }
+    } else if (cmd == "timers") {
+        auto Timers = LuaAPI::MP::Engine->Debug_GetTimersForState(mStateId);
+        Application::Console().WriteRaw("Event timers for State '" + mStateId + "'");
+        for (const auto& Timer : Timers) {
+            Application::Console().WriteRaw(fmt::format("    Event '{}' every {}ms: fired {}, skipped {}, drift avg {:.2f}ms, max {:.2f}ms",
+                Timer.EventName, Timer.Interval.count(), Timer.Fired, Timer.Skipped,
+                Timer.AverageDrift.count() / 1000.0, Timer.MaxDrift.count() / 1000.0));
+        }
     } else if (cmd == "help") {
         Application::Console().WriteRaw(R"(BeamMP Lua Debugger
     All commands must be prefixed with a `:`. Non-prefixed commands are interpreted as Lua.
@@ -719,7 +745,8 @@ Commands
     :exit         detaches (exits) from this Lua console
     :help         displays this help
     :events       shows a list of currently registered events
-    :queued       shows a list of all pending and queued functions)");
+    :queued       shows how many calls, scripts and timer ticks are waiting to run
+    :timers       shows this state's event timers and how late they fire)");
     } else {
         beammp_error("internal command '" + cmd + "' is not known");
     }
@@ -0,0 +1,198 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "TEventJournal.h"
+
+#include "Common.h"
+
+#ifdef BEAMMP_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static uint64_t NowNs() {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+TEventJournal::TScope::TScope(TEventJournal* Journal, TJournalKind Kind, int PlayerID, uint8_t Code, size_t Size)
+    : mJournal(Journal)
+    , mKind(Kind)
+    , mPlayerID(PlayerID)
+    , mCode(Code)
+    , mSize(Size) {
+    // no clock reads when the journal is off
+    if (mJournal) {
+        mStart = std::chrono::steady_clock::now();
+    }
+}
+
+TEventJournal::TScope::~TScope() {
+    if (mJournal) {
+        mJournal->Record(mKind, mPlayerID, mCode, mSize, std::chrono::steady_clock::now() - mStart);
+    }
+}
+
+TEventJournal::~TEventJournal() {
+    Close();
+}
+
+bool TEventJournal::Open(const std::string& Path, size_t Capacity) {
+    Close();
+    if (Capacity == 0) {
+        return false;
+    }
+    const size_t Size = sizeof(TJournalFileHeader) + Capacity * sizeof(TJournalRecord);
+#ifdef BEAMMP_WINDOWS
+    HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (File == INVALID_HANDLE_VALUE) {
+        beammp_errorf("Failed to create event journal '{}': {}", Path, GetPlatformAgnosticErrorString());
+        return false;
+    }
+    HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READWRITE, DWORD(uint64_t(Size) >> 32), DWORD(Size & 0xffffffff), nullptr);
+    void* View = Mapping ? MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, Size) : nullptr;
+    if (!View) {
+        beammp_errorf("Failed to map event journal '{}': {}", Path, GetPlatformAgnosticErrorString());
+        if (Mapping) {
+            CloseHandle(Mapping);
+        }
+        CloseHandle(File);
+        return false;
+    }
+    mFileHandle = File;
+    mMappingHandle = Mapping;
+#else
+    int Fd = ::open(Path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (Fd < 0) {
+        beammp_errorf("Failed to create event journal '{}': {}", Path, GetPlatformAgnosticErrorString());
+        return false;
+    }
+    // the new space reads as zeroes, so every record starts out as "never written"
+    if (ftruncate(Fd, off_t(Size)) != 0) {
+        beammp_errorf("Failed to resize event journal '{}': {}", Path, GetPlatformAgnosticErrorString());
+        ::close(Fd);
+        return false;
+    }
+    void* View = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+    // the mapping keeps the file open
+    ::close(Fd);
+    if (View == MAP_FAILED) {
+        beammp_errorf("Failed to map event journal '{}': {}", Path, GetPlatformAgnosticErrorString());
+        return false;
+    }
+#endif
+    mMapping = View;
+    mMappingSize = Size;
+    auto* Header = static_cast<TJournalFileHeader*>(View);
+    std::memcpy(Header->Magic, TJournalFileHeader::ExpectedMagic, sizeof(Header->Magic));
+    Header->Version = TJournalFileHeader::CurrentVersion;
+    Header->RecordSize = sizeof(TJournalRecord);
+    Header->Capacity = Capacity;
+    Header->CreatedNs = NowNs();
+    mRecords = reinterpret_cast<TJournalRecord*>(static_cast<uint8_t*>(View) + sizeof(TJournalFileHeader));
+    mCapacity = Capacity;
+    mNext.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void TEventJournal::Close() {
+    if (!mMapping) {
+        return;
+    }
+#ifdef BEAMMP_WINDOWS
+    FlushViewOfFile(mMapping, 0);
+    UnmapViewOfFile(mMapping);
+    CloseHandle(mMappingHandle);
+    CloseHandle(mFileHandle);
+    mMappingHandle = nullptr;
+    mFileHandle = nullptr;
+#else
+    munmap(mMapping, mMappingSize);
+#endif
+    mMapping = nullptr;
+    mMappingSize = 0;
+    mRecords = nullptr;
+    mCapacity = 0;
+}
+
+void TEventJournal::Record(TJournalKind Kind, int PlayerID, uint8_t Code, size_t Size, std::chrono::nanoseconds Latency) {
+    if (!mRecords) {
+        return;
+    }
+    const auto Index = mNext.fetch_add(1, std::memory_order_relaxed);
+    auto& Slot = mRecords[Index % mCapacity];
+    std::atomic_ref<uint64_t> Sequence(Slot.Sequence);
+    // marks the record as incomplete, in case the file is read while we write
+    Sequence.store(0, std::memory_order_relaxed);
+    Slot.TimestampNs = NowNs();
+    Slot.PlayerID = PlayerID;
+    Slot.Size = uint32_t(std::min<size_t>(Size, UINT32_MAX));
+    Slot.LatencyUs = uint32_t(std::min<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Latency).count(), UINT32_MAX));
+    Slot.Code = Code;
+    Slot.Kind = Kind;
+    Slot.Reserved = 0;
+    Sequence.store(Index + 1, std::memory_order_release);
+}
+
+TEST_CASE("TEventJournal") {
+    const std::string Path = "TEventJournalTest.journal";
+
+    SUBCASE("Disabled journal records nothing") {
+        TEventJournal Journal;
+        CHECK_FALSE(Journal.IsEnabled());
+        Journal.Record(TJournalKind::Parsed, 0, 'Z', 10);
+        CHECK_EQ(Journal.Count(), 0);
+    }
+    SUBCASE("Ring keeps the newest records") {
+        {
+            TEventJournal Journal;
+            REQUIRE(Journal.Open(Path, 8));
+            for (int i = 0; i < 20; ++i) {
+                Journal.Record(TJournalKind::TcpReceived, i, 'O', size_t(i) * 10, std::chrono::microseconds(i));
+            }
+        }
+        auto Records = ReadEventJournal(Path);
+        REQUIRE(Records.has_value());
+        REQUIRE_EQ(Records->size(), 8);
+        for (size_t i = 0; i < Records->size(); ++i) {
+            const auto& Record = Records->at(i);
+            CHECK_EQ(Record.Sequence, 13 + i);
+            CHECK_EQ(Record.PlayerID, int(12 + i));
+            CHECK_EQ(Record.Size, (12 + i) * 10);
+            CHECK_EQ(Record.LatencyUs, 12 + i);
+            CHECK_EQ(Record.Code, 'O');
+            CHECK_EQ(Record.Kind, TJournalKind::TcpReceived);
+        }
+    }
+    SUBCASE("Scope measures latency") {
+        {
+            TEventJournal Journal;
+            REQUIRE(Journal.Open(Path, 8));
+            auto Scope = Journal.Measure(TJournalKind::Parsed, 1, 'E', 5);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        auto Records = ReadEventJournal(Path);
+        REQUIRE(Records.has_value());
+        REQUIRE_EQ(Records->size(), 1);
+        CHECK(Records->front().LatencyUs >= 2000);
+    }
+    fs::remove(Path);
+}
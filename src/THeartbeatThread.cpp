@@ -41,19 +41,33 @@ void THeartbeatThread::operator()() {
     static std::chrono::high_resolution_clock::time_point LastUpdateReminderTime = std::chrono::high_resolution_clock::now();
     bool isAuth = false;
     std::chrono::high_resolution_clock::duration UpdateReminderTimePassed;
+    // the body is only rebuilt when something public changed, or when the
+    // keepalive is due
+    uint64_t SeenVersion = Application::PublicStateVersion();
+    Body = GenerateCall();
     while (!Application::IsShuttingDown()) {
         auto UpdateReminderTimeout = ChronoWrapper::TimeFromStringWithLiteral(Application::Settings.getAsString(Settings::Key::Misc_UpdateReminderTime));
-        Body = GenerateCall();
+        if (auto Version = Application::PublicStateVersion(); Version != SeenVersion) {
+            SeenVersion = Version;
+            Body = GenerateCall();
+        }
         // a hot-change occurs when a setting has changed, to update the backend of that change.
         auto Now = std::chrono::high_resolution_clock::now();
         bool Unchanged = Last == Body;
         auto TimePassed = (Now - LastNormalUpdateTime);
         UpdateReminderTimePassed = (Now - LastUpdateReminderTime);
-        auto Threshold = Unchanged ? 30 : 5;
-        if (TimePassed < std::chrono::seconds(Threshold)) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto Threshold = std::chrono::seconds(Unchanged ? 30 : 5);
+        if (TimePassed < Threshold) {
+            // a change wakes us up early, but a changed body is still only sent
+            // 5s after the last heartbeat, in case it changes a lot
+            Application::WaitForPublicStateChange(SeenVersion, Threshold - TimePassed);
             continue;
         }
+        if (Unchanged) {
+            // keepalive, rebuilt in case something changed without a notification
+            SeenVersion = Application::PublicStateVersion();
+            Body = GenerateCall();
+        }
         beammp_debug("heartbeat (after " + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(TimePassed).count()) + "s)");
 
         Last = Body;
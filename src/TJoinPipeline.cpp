@@ -0,0 +1,209 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "TJoinPipeline.h"
+
+#include "Common.h"
+#include <thread>
+
+TJoinStage::TSlot::TSlot(TJoinStage& Stage)
+    : mStage(Stage) {
+}
+
+TJoinStage::TSlot::~TSlot() {
+    mStage.Leave();
+}
+
+TJoinStage::TJoinStage(std::string Name, std::function<int()> Limit)
+    : mName(std::move(Name))
+    , mLimit(std::move(Limit)) {
+}
+
+std::optional<TJoinStage::TSlot> TJoinStage::Enter() {
+    return Enter(Application::ShutdownToken());
+}
+
+std::optional<TJoinStage::TSlot> TJoinStage::Enter(std::stop_token Stop) {
+    const auto Start = std::chrono::steady_clock::now();
+    std::unique_lock Lock(mMutex);
+    const auto Ticket = mNextTicket++;
+    mPeakQueued = std::max(mPeakQueued, size_t(mNextTicket - mNextAdmitted));
+    // the limit is re-read whenever a slot frees up or the limit changes, so
+    // changes from the console apply to clients which are already queued
+    const bool Admitted = mCondition.wait(Lock, Stop, [&] {
+        const int Limit = mLimit();
+        return Ticket == mNextAdmitted && (Limit <= 0 || mActive < size_t(Limit));
+    });
+    if (!Admitted) {
+        if (Ticket == mNextAdmitted) {
+            AdvanceAdmittedLocked();
+        } else {
+            mAbandoned.insert(Ticket);
+        }
+        Lock.unlock();
+        mCondition.notify_all();
+        return std::nullopt;
+    }
+    AdvanceAdmittedLocked();
+    ++mActive;
+    const auto Waited = std::chrono::steady_clock::now() - Start;
+    mTotalWait += Waited;
+    mMaxWait = std::max(mMaxWait, Waited);
+    if (Waited > std::chrono::seconds(1)) {
+        beammp_debugf("Join stage '{}': waited {}ms for a free slot", mName, std::chrono::duration_cast<std::chrono::milliseconds>(Waited).count());
+    }
+    Lock.unlock();
+    // the next in line may be able to enter as well
+    mCondition.notify_all();
+    return std::optional<TSlot>(std::in_place, *this);
+}
+
+void TJoinStage::AdvanceAdmittedLocked() {
+    ++mNextAdmitted;
+    while (mAbandoned.erase(mNextAdmitted) > 0) {
+        ++mNextAdmitted;
+    }
+}
+
+void TJoinStage::LimitChanged() {
+    {
+        // so that a waiter can't check the old limit and then miss this wakeup
+        std::unique_lock Lock(mMutex);
+    }
+    mCondition.notify_all();
+}
+
+void TJoinStage::Leave() {
+    {
+        std::unique_lock Lock(mMutex);
+        --mActive;
+        ++mCompleted;
+    }
+    mCondition.notify_all();
+}
+
+TJoinStage::TStats TJoinStage::Stats() const {
+    std::unique_lock Lock(mMutex);
+    const size_t Admitted = mCompleted + mActive;
+    return TStats {
+        .Active = mActive,
+        .Queued = size_t(mNextTicket - mNextAdmitted) - mAbandoned.size(),
+        .PeakQueued = mPeakQueued,
+        .Completed = mCompleted,
+        .Limit = mLimit(),
+        .AverageWait = Admitted == 0 ? std::chrono::milliseconds(0) : std::chrono::duration_cast<std::chrono::milliseconds>(mTotalWait / Admitted),
+        .MaxWait = std::chrono::duration_cast<std::chrono::milliseconds>(mMaxWait),
+    };
+}
+
+TJoinPipeline::TJoinPipeline()
+    : Auth("Auth", [] { return Application::Settings.getAsInt(Settings::Key::Misc_MaxConcurrentAuths); })
+    , ResourceSync("ResourceSync", [] { return Application::Settings.getAsInt(Settings::Key::Misc_MaxConcurrentResourceSyncs); })
+    , WorldSync("WorldSync", [] { return Application::Settings.getAsInt(Settings::Key::Misc_MaxConcurrentWorldSyncs); })
+    , mSettingsListener(Application::Settings.addChangeListener([this] {
+        Auth.LimitChanged();
+        ResourceSync.LimitChanged();
+        WorldSync.LimitChanged();
+    })) {
+}
+
+TJoinPipeline::~TJoinPipeline() {
+    Application::Settings.removeChangeListener(mSettingsListener);
+}
+
+TEST_CASE("TJoinStage") {
+    SUBCASE("Limits concurrency") {
+        TJoinStage Stage("Test", [] { return 2; });
+        std::atomic<int> Inside = 0;
+        std::atomic<int> MaxInside = 0;
+        std::vector<std::thread> Threads;
+        for (int i = 0; i < 8; ++i) {
+            Threads.emplace_back([&] {
+                auto Slot = Stage.Enter();
+                const int Now = ++Inside;
+                int Max = MaxInside.load();
+                while (Now > Max && !MaxInside.compare_exchange_weak(Max, Now)) { }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                --Inside;
+            });
+        }
+        for (auto& Thread : Threads) {
+            Thread.join();
+        }
+        CHECK(MaxInside.load() <= 2);
+        const auto Stats = Stage.Stats();
+        CHECK_EQ(Stats.Completed, 8);
+        CHECK_EQ(Stats.Active, 0);
+        CHECK_EQ(Stats.Queued, 0);
+        CHECK_EQ(Stats.Limit, 2);
+    }
+    SUBCASE("No limit") {
+        TJoinStage Stage("Test", [] { return 0; });
+        auto A = Stage.Enter();
+        auto B = Stage.Enter();
+        auto C = Stage.Enter();
+        CHECK(A.has_value());
+        CHECK(B.has_value());
+        CHECK(C.has_value());
+        CHECK_EQ(Stage.Stats().Active, 3);
+    }
+    SUBCASE("Stopping gives up instead of admitting") {
+        TJoinStage Stage("Test", [] { return 1; });
+        std::stop_source Stop;
+        auto Held = Stage.Enter(Stop.get_token());
+        REQUIRE(Held.has_value());
+        bool Returned = false;
+        bool Admitted = false;
+        std::thread Waiter([&] {
+            Admitted = Stage.Enter(Stop.get_token()).has_value();
+            Returned = true;
+        });
+        while (Stage.Stats().Queued == 0) {
+            std::this_thread::yield();
+        }
+        Stop.request_stop();
+        Waiter.join();
+        CHECK(Returned);
+        CHECK_FALSE(Admitted);
+        CHECK_EQ(Stage.Stats().Active, 1);
+        CHECK_EQ(Stage.Stats().Queued, 0);
+        // an already stopped token doesn't get in either
+        CHECK_FALSE(Stage.Enter(Stop.get_token()).has_value());
+        // and giving up doesn't hold up the callers behind it
+        Held.reset();
+        CHECK(Stage.Enter().has_value());
+    }
+    SUBCASE("Raising the limit admits queued callers") {
+        std::atomic<int> Limit = 1;
+        TJoinStage Stage("Test", [&Limit] { return Limit.load(); });
+        auto Held = Stage.Enter();
+        REQUIRE(Held.has_value());
+        std::thread Waiter([&] {
+            auto Slot = Stage.Enter();
+            CHECK(Slot.has_value());
+        });
+        while (Stage.Stats().Queued == 0) {
+            std::this_thread::yield();
+        }
+        // the held slot is never released, only the limit change can let it in
+        Limit = 2;
+        Stage.LimitChanged();
+        Waiter.join();
+        CHECK_EQ(Stage.Stats().Completed, 1);
+    }
+}
@@ -0,0 +1,505 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "TLogSink.h"
+
+#include "Common.h"
+#include "Compat.h"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <ctime>
+#include <fstream>
+#include <optional>
+#include <vector>
+#include <zlib.h>
+
+#ifdef BEAMMP_WINDOWS
+#include <io.h>
+#endif
+
+TLogSink::TLogSink(const std::string& Path, size_t Capacity, std::function<std::chrono::milliseconds()> SyncInterval, std::function<TRotation()> Rotation)
+    : mPath(Path)
+    , mFile(std::fopen(Path.c_str(), "w"))
+    , mOpen(mFile != nullptr)
+    , mFileOpened(std::chrono::steady_clock::now())
+    , mSyncInterval(std::move(SyncInterval))
+    , mRotation(std::move(Rotation))
+    , mCapacity(std::bit_ceil(std::max<size_t>(Capacity, 2)))
+    , mSlots(std::make_unique<TSlot[]>(mCapacity)) {
+    for (size_t i = 0; i < mCapacity; ++i) {
+        mSlots[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+    if (mFile) {
+        mWriter = std::thread(&TLogSink::WriterMain, this);
+        if (mRotation) {
+            mCompressor = std::thread(&TLogSink::CompressorMain, this);
+        }
+    }
+}
+
+TLogSink::~TLogSink() {
+    if (mWriter.joinable()) {
+        {
+            std::unique_lock Lock(mWakeupMutex);
+            mStopping.store(true, std::memory_order_release);
+        }
+        mWakeupCondition.notify_one();
+        mWriter.join();
+    }
+    if (mCompressor.joinable()) {
+        // the compressor finishes whatever the writer queued before it stops
+        {
+            std::unique_lock Lock(mCompressorMutex);
+            mCompressorStopping = true;
+        }
+        mCompressorCondition.notify_one();
+        mCompressor.join();
+    }
+    if (mFile) {
+        std::fclose(mFile);
+    }
+}
+
+bool TLogSink::Write(std::string Line) {
+    if (!mOpen) {
+        return false;
+    }
+    auto Pos = mEnqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        auto& Slot = mSlots[Pos & (mCapacity - 1)];
+        const auto Sequence = Slot.Sequence.load(std::memory_order_acquire);
+        const auto Diff = int64_t(Sequence) - int64_t(Pos);
+        if (Diff == 0) {
+            // slot is free, try to claim it
+            if (mEnqueuePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed)) {
+                Slot.Line = std::move(Line);
+                Slot.Sequence.store(Pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (Diff < 0) {
+            // the writer hasn't gotten to this slot yet, so we're full
+            mDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            // another producer got this slot first
+            Pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+    // seq_cst, paired with the writer setting mWriterWaiting and then reading
+    // mWakeups: either we see it waiting, or it sees this write
+    mWakeups.fetch_add(1, std::memory_order_seq_cst);
+    if (mWriterWaiting.load(std::memory_order_seq_cst)) {
+        {
+            // the writer holds this until it's asleep, so the notify can't get lost
+            std::unique_lock Lock(mWakeupMutex);
+        }
+        mWakeupCondition.notify_one();
+    }
+    return true;
+}
+
+bool TLogSink::TryPop(std::string& Line) {
+    auto& Slot = mSlots[mDequeuePos & (mCapacity - 1)];
+    const auto Sequence = Slot.Sequence.load(std::memory_order_acquire);
+    if (int64_t(Sequence) - int64_t(mDequeuePos + 1) < 0) {
+        return false;
+    }
+    Line = std::move(Slot.Line);
+    Slot.Sequence.store(mDequeuePos + mCapacity, std::memory_order_release);
+    ++mDequeuePos;
+    return true;
+}
+
+void TLogSink::Sync() {
+    std::fflush(mFile);
+#ifdef BEAMMP_WINDOWS
+    _commit(_fileno(mFile));
+#else
+    fsync(fileno(mFile));
+#endif
+}
+
+bool TLogSink::ShouldRotate(const TRotation& Rotation) const {
+    if (!mFile) {
+        // try to open a new file
+        return true;
+    }
+    if (mFileSize == 0) {
+        return false;
+    }
+    return (Rotation.MaxBytes > 0 && mFileSize >= Rotation.MaxBytes)
+        || (Rotation.MaxAge.count() > 0 && std::chrono::steady_clock::now() - mFileOpened >= Rotation.MaxAge);
+}
+
+void TLogSink::Rotate(const TRotation& Rotation) {
+    std::string Rotated;
+    if (mFile) {
+        Sync();
+        std::fclose(mFile);
+        mFile = nullptr;
+
+        const auto Now = std::time(nullptr);
+        std::tm Local {};
+#ifdef BEAMMP_WINDOWS
+        localtime_s(&Local, &Now);
+#else
+        localtime_r(&Now, &Local);
+#endif
+        char Timestamp[32] {};
+        std::strftime(Timestamp, sizeof(Timestamp), "%Y-%m-%d_%H-%M-%S", &Local);
+        const auto Stem = fs::path(mPath).replace_extension().string();
+        Rotated = fmt::format("{}.{}.log", Stem, Timestamp);
+        // more than one rotation per second
+        for (int i = 1; fs::exists(Rotated) || fs::exists(Rotated + ".gz"); ++i) {
+            Rotated = fmt::format("{}.{}-{}.log", Stem, Timestamp, i);
+        }
+        std::error_code Ec;
+        fs::rename(mPath, Rotated, Ec);
+        if (Ec) {
+            Rotated.clear();
+        }
+    }
+    // if renaming failed, this truncates the old file, which still beats filling
+    // up the disk
+    mFile = std::fopen(mPath.c_str(), "w");
+    mFileSize = 0;
+    mFileOpened = std::chrono::steady_clock::now();
+    if (!Rotated.empty()) {
+        {
+            std::unique_lock Lock(mCompressorMutex);
+            mPendingArchives.push_back(TPendingArchive { std::move(Rotated), Rotation.KeepArchives });
+        }
+        mCompressorCondition.notify_one();
+    }
+}
+
+void TLogSink::CompressorMain() {
+    RegisterThread("LogCompressor");
+    std::unique_lock Lock(mCompressorMutex);
+    while (true) {
+        mCompressorCondition.wait(Lock, [this] { return mCompressorStopping || !mPendingArchives.empty(); });
+        if (mPendingArchives.empty()) {
+            break;
+        }
+        auto Pending = std::move(mPendingArchives.front());
+        mPendingArchives.pop_front();
+        Lock.unlock();
+        CompressAndPrune(mPath, Pending.Rotated, Pending.KeepArchives);
+        Lock.lock();
+    }
+}
+
+// Splits e.g. "Server.2024-01-31_12-00-00-2.log.gz" into its timestamp and
+// same-second suffix (0 if there is none), so that archives sort by when they
+// were rotated. Returns nullopt for files that don't look like our archives.
+static std::optional<std::pair<std::string, int>> ArchiveOrder(std::string_view Name, std::string_view Prefix) {
+    constexpr std::string_view Extension = ".log.gz";
+    constexpr size_t TimestampLength = std::string_view("2024-01-31_12-00-00").size();
+    if (!Name.starts_with(Prefix) || !Name.ends_with(Extension)) {
+        return std::nullopt;
+    }
+    Name.remove_prefix(Prefix.size());
+    Name.remove_suffix(Extension.size());
+    if (Name.size() < TimestampLength) {
+        return std::nullopt;
+    }
+    const auto Timestamp = Name.substr(0, TimestampLength);
+    Name.remove_prefix(TimestampLength);
+    int Suffix = 0;
+    if (!Name.empty()) {
+        if (Name.front() != '-') {
+            return std::nullopt;
+        }
+        Name.remove_prefix(1);
+        const auto [End, Ec] = std::from_chars(Name.data(), Name.data() + Name.size(), Suffix);
+        if (Ec != std::errc() || End != Name.data() + Name.size()) {
+            return std::nullopt;
+        }
+    }
+    return std::make_pair(std::string(Timestamp), Suffix);
+}
+
+void TLogSink::CompressAndPrune(const std::string& Path, const std::string& Rotated, size_t KeepArchives) {
+    const auto Archive = Rotated + ".gz";
+    bool Ok = false;
+    if (auto In = std::fopen(Rotated.c_str(), "rb")) {
+        if (auto Out = gzopen(Archive.c_str(), "wb")) {
+            Ok = true;
+            std::vector<char> Buffer(64 * KB);
+            size_t Read = 0;
+            while ((Read = std::fread(Buffer.data(), 1, Buffer.size(), In)) > 0) {
+                if (gzwrite(Out, Buffer.data(), unsigned(Read)) != int(Read)) {
+                    Ok = false;
+                    break;
+                }
+            }
+            Ok = gzclose(Out) == Z_OK && Ok;
+        }
+        std::fclose(In);
+    }
+    std::error_code Ec;
+    if (Ok) {
+        fs::remove(Rotated, Ec);
+    } else {
+        // keep the uncompressed file rather than losing it
+        fs::remove(Archive, Ec);
+    }
+    if (KeepArchives == 0) {
+        return;
+    }
+    const auto LogPath = fs::path(Path);
+    const auto Prefix = LogPath.stem().string() + ".";
+    auto Directory = LogPath.parent_path();
+    if (Directory.empty()) {
+        Directory = ".";
+    }
+    std::vector<std::pair<std::pair<std::string, int>, fs::path>> Archives;
+    for (const auto& Entry : fs::directory_iterator(Directory, Ec)) {
+        if (auto Order = ArchiveOrder(Entry.path().filename().string(), Prefix)) {
+            Archives.emplace_back(std::move(*Order), Entry.path());
+        }
+    }
+    if (Archives.size() <= KeepArchives) {
+        return;
+    }
+    // oldest first
+    std::sort(Archives.begin(), Archives.end());
+    for (size_t i = 0; i < Archives.size() - KeepArchives; ++i) {
+        fs::remove(Archives[i].second, Ec);
+    }
+}
+
+void TLogSink::WriterMain() {
+    std::string Batch;
+    std::string Line;
+    size_t ReportedDropped = 0;
+    bool Unsynced = false;
+    auto LastSync = std::chrono::steady_clock::now();
+    while (true) {
+        const auto Seen = mWakeups.load(std::memory_order_acquire);
+        const bool Stopping = mStopping.load(std::memory_order_acquire);
+        Batch.clear();
+        while (TryPop(Line)) {
+            Batch += Line;
+            Batch += '\n';
+        }
+        if (const auto Dropped = mDropped.load(std::memory_order_relaxed); Dropped != ReportedDropped) {
+            Batch += fmt::format("[LOG] {} log line(s) were dropped because the log file couldn't keep up\n", Dropped - ReportedDropped);
+            ReportedDropped = Dropped;
+        }
+        if (mRotation) {
+            if (const auto Rotation = mRotation(); ShouldRotate(Rotation)) {
+                Rotate(Rotation);
+                Unsynced = false;
+            }
+        }
+        if (!Batch.empty()) {
+            if (mFile) {
+                std::fwrite(Batch.data(), 1, Batch.size(), mFile);
+                std::fflush(mFile);
+                mFileSize += Batch.size();
+                Unsynced = true;
+            } else {
+                // the log file couldn't be reopened after rotating, lines are lost
+                mDropped.fetch_add(size_t(std::count(Batch.begin(), Batch.end(), '\n')), std::memory_order_relaxed);
+            }
+        }
+        const auto Now = std::chrono::steady_clock::now();
+        const auto Interval = mSyncInterval();
+        if (Unsynced && (Stopping || Now - LastSync >= Interval)) {
+            Sync();
+            Unsynced = false;
+            LastSync = Now;
+        }
+        if (Stopping) {
+            // producers may still have written after we were told to stop
+            if (Batch.empty()) {
+                break;
+            }
+            continue;
+        }
+        if (!Batch.empty()) {
+            continue;
+        }
+        std::unique_lock Lock(mWakeupMutex);
+        mWriterWaiting.store(true, std::memory_order_seq_cst);
+        auto Woken = [&] {
+            return mWakeups.load(std::memory_order_seq_cst) != Seen || mStopping.load(std::memory_order_acquire);
+        };
+        if (Unsynced) {
+            // come back for the sync even if nothing else gets logged
+            mWakeupCondition.wait_until(Lock, LastSync + Interval, Woken);
+        } else {
+            mWakeupCondition.wait(Lock, Woken);
+        }
+        mWriterWaiting.store(false, std::memory_order_relaxed);
+    }
+}
+
+TEST_CASE("TLogSink") {
+    const std::string Path = "TLogSinkTest.log";
+    auto ReadLines = [&Path] {
+        std::vector<std::string> Lines;
+        std::ifstream File(Path);
+        for (std::string Line; std::getline(File, Line);) {
+            Lines.push_back(Line);
+        }
+        return Lines;
+    };
+
+    SUBCASE("Writes all lines in order") {
+        {
+            TLogSink Sink(Path, 1024, [] { return std::chrono::milliseconds(0); });
+            REQUIRE(Sink.IsOpen());
+            for (int i = 0; i < 100; ++i) {
+                Sink.Write(std::to_string(i));
+            }
+        }
+        auto Lines = ReadLines();
+        REQUIRE_EQ(Lines.size(), 100);
+        for (int i = 0; i < 100; ++i) {
+            CHECK_EQ(Lines[size_t(i)], std::to_string(i));
+        }
+    }
+    SUBCASE("Multiple producers, lines are written or counted as dropped") {
+        size_t Dropped = 0;
+        {
+            TLogSink Sink(Path, 16, [] { return std::chrono::seconds(5); });
+            std::vector<std::thread> Threads;
+            for (int t = 0; t < 4; ++t) {
+                Threads.emplace_back([&Sink, t] {
+                    for (int i = 0; i < 1000; ++i) {
+                        Sink.Write(fmt::format("{}:{}", t, i));
+                    }
+                });
+            }
+            for (auto& Thread : Threads) {
+                Thread.join();
+            }
+            Dropped = Sink.Dropped();
+        }
+        auto Lines = ReadLines();
+        const auto Written = std::count_if(Lines.begin(), Lines.end(), [](const std::string& Line) {
+            return !Line.starts_with("[LOG]");
+        });
+        CHECK_EQ(size_t(Written) + Dropped, 4000);
+        size_t ReportedDropped = 0;
+        for (const auto& Line : Lines) {
+            if (Line.starts_with("[LOG] ")) {
+                ReportedDropped += std::stoul(Line.substr(6));
+            }
+        }
+        CHECK_EQ(ReportedDropped, Dropped);
+    }
+    fs::remove(Path);
+}
+
+TEST_CASE("TLogSink rotation") {
+    const fs::path Directory = "TLogSinkRotationTest";
+    fs::remove_all(Directory);
+    fs::create_directories(Directory);
+    const auto Path = (Directory / "Server.log").string();
+
+    size_t Keep = 0;
+    {
+        TLogSink Sink(Path, 1024, [] { return std::chrono::milliseconds(0); }, [&Keep] {
+            return TLogSink::TRotation { .MaxBytes = 100, .KeepArchives = Keep };
+        });
+        for (int i = 0; i < 50; ++i) {
+            Sink.Write(fmt::format("line {:03}", i));
+            // give the writer a chance to write lines in several batches
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // all lines are either in the log file or in an archive
+    size_t Lines = 0;
+    size_t Archives = 0;
+    for (const auto& Entry : fs::directory_iterator(Directory)) {
+        const auto Name = Entry.path().filename().string();
+        std::string Content;
+        if (Name.ends_with(".gz")) {
+            ++Archives;
+            auto File = gzopen(Entry.path().string().c_str(), "rb");
+            REQUIRE(File);
+            char Buffer[4096];
+            int Read = 0;
+            while ((Read = gzread(File, Buffer, sizeof(Buffer))) > 0) {
+                Content.append(Buffer, size_t(Read));
+            }
+            gzclose(File);
+        } else {
+            std::ifstream File(Entry.path());
+            Content.assign(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+        }
+        Lines += size_t(std::count(Content.begin(), Content.end(), '\n'));
+    }
+    CHECK(Archives > 0);
+    CHECK_EQ(Lines, 50);
+
+    SUBCASE("Retention") {
+        Keep = 2;
+        {
+            TLogSink Sink(Path, 1024, [] { return std::chrono::milliseconds(0); }, [&Keep] {
+                return TLogSink::TRotation { .MaxBytes = 100, .KeepArchives = Keep };
+            });
+            for (int i = 0; i < 50; ++i) {
+                Sink.Write(fmt::format("line {:03}", i));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        size_t Remaining = 0;
+        for (const auto& Entry : fs::directory_iterator(Directory)) {
+            if (Entry.path().filename().string().ends_with(".log.gz")) {
+                ++Remaining;
+            }
+        }
+        CHECK(Remaining <= 2);
+    }
+    fs::remove_all(Directory);
+}
+
+TEST_CASE("TLogSink archive order") {
+    const std::string Prefix = "Server.";
+    std::vector<std::string> Names {
+        "Server.2024-01-31_12-00-01.log.gz",
+        "Server.2024-01-31_12-00-00-10.log.gz",
+        "Server.2024-01-31_12-00-00-2.log.gz",
+        "Server.2024-01-31_12-00-00-1.log.gz",
+        "Server.2024-01-31_12-00-00.log.gz",
+    };
+    std::vector<std::pair<std::pair<std::string, int>, std::string>> Sorted;
+    for (const auto& Name : Names) {
+        auto Order = ArchiveOrder(Name, Prefix);
+        REQUIRE(Order.has_value());
+        Sorted.emplace_back(*Order, Name);
+    }
+    std::sort(Sorted.begin(), Sorted.end());
+    CHECK_EQ(Sorted[0].second, "Server.2024-01-31_12-00-00.log.gz");
+    CHECK_EQ(Sorted[1].second, "Server.2024-01-31_12-00-00-1.log.gz");
+    CHECK_EQ(Sorted[2].second, "Server.2024-01-31_12-00-00-2.log.gz");
+    CHECK_EQ(Sorted[3].second, "Server.2024-01-31_12-00-00-10.log.gz");
+    CHECK_EQ(Sorted[4].second, "Server.2024-01-31_12-00-01.log.gz");
+
+    CHECK_FALSE(ArchiveOrder("Server.log.gz", Prefix).has_value());
+    CHECK_FALSE(ArchiveOrder("Server.old.log.gz", Prefix).has_value());
+    CHECK_FALSE(ArchiveOrder("Server.2024-01-31_12-00-00-x.log.gz", Prefix).has_value());
+    CHECK_FALSE(ArchiveOrder("Other.2024-01-31_12-00-00.log.gz", Prefix).has_value());
+}
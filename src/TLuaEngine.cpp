@@ -26,6 +26,9 @@
 #include "TLuaPlugin.h"
 #include "sol/object.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <chrono>
 #include <condition_variable>
 #include <fmt/core.h>
@@ -40,20 +43,121 @@ TLuaEngine* LuaAPI::MP::Engine;
 
 static sol::protected_function AddTraceback(sol::state_view StateView, sol::protected_function RawFn);
 
-static std::optional<sol::function> GetLuaHandler(sol::state_view StateView, const std::string Handler, const std::string EventName);
+static bool IsLuaIdentifier(std::string_view Name) {
+    if (Name.empty() || std::isdigit(static_cast<unsigned char>(Name.front()))) {
+        return false;
+    }
+    return std::all_of(Name.begin(), Name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+}
+
+static bool IsSameLuaValue(lua_State* L, const sol::object& A, const sol::object& B) {
+    A.push(L);
+    B.push(L);
+    bool Same = lua_rawequal(L, -1, -2);
+    lua_pop(L, 2);
+    return Same;
+}
+
+std::optional<TLuaHandlerCache::THandler> TLuaHandlerCache::Get(sol::state_view StateView, TStringId HandlerId, const std::string& EventName) {
+    const auto& Handler = TStringInterner::Global().Get(HandlerId);
+    auto Iter = mHandlers.find(HandlerId);
+    sol::object Resolved;
+    if (IsLuaIdentifier(Handler)) {
+        // a global is cheap to look up, so make sure it wasn't reassigned since it was cached
+        Resolved = StateView.globals().get<sol::object>(Handler);
+        if (Iter != mHandlers.end() && IsSameLuaValue(StateView.lua_state(), Iter->second.Resolved, Resolved)) {
+            return Iter->second.Handler;
+        }
+    } else if (Iter != mHandlers.end()) {
+        return Iter->second.Handler;
+    } else {
+        auto Res = StateView.safe_script("return " + Handler, sol::script_pass_on_error);
+        if (!Res.valid()) {
+            beammp_errorf("invalid handler for event \"{}\". handler: \"{}\"", EventName, Handler);
+            return std::nullopt;
+        }
+        Resolved = Res.get<sol::object>();
+    }
+    if (Resolved.get_type() != sol::type::function) {
+        if (Iter != mHandlers.end()) {
+            mHandlers.erase(Iter);
+        }
+        return std::nullopt;
+    }
+    auto Fn = Resolved.as<sol::protected_function>();
+    THandler Result { Fn, AddTraceback(StateView, Fn) };
+    mHandlers.insert_or_assign(HandlerId, TEntry { std::move(Resolved), Result });
+    return Result;
+}
+
+TEST_CASE("TLuaHandlerCache") {
+    sol::state State;
+    State.open_libraries(sol::lib::base, sol::lib::debug);
+    State.script("function onTest(x) return x + 1 end\nM = { onTest = function(x) return x + 2 end }");
+    TLuaHandlerCache Cache;
+    auto Get = [&](std::string_view Handler) {
+        return Cache.Get(State, TStringInterner::Global().Intern(Handler), "test");
+    };
 
-static std::optional<sol::function> GetLuaHandler(sol::state_view StateView, const std::string Handler, const std::string EventName) {
-    auto Res = StateView.safe_script("return " + Handler, sol::script_pass_on_error);
-    if (!Res.valid()) {
-        beammp_errorf("invalid handler for event \"{}\". handler: \"{}\"", EventName, Handler);
-    } else if (Res.get_type() == sol::type::function) {
-        return Res.get<sol::function>();
+    SUBCASE("Resolves globals and tables") {
+        auto Global = Get("onTest");
+        REQUIRE(Global.has_value());
+        CHECK(Global->Fn(1).get<int>() == 2);
+        auto Field = Get("M.onTest");
+        REQUIRE(Field.has_value());
+        CHECK(Field->Fn(1).get<int>() == 3);
+        CHECK(Cache.Size() == 2);
+        CHECK(!Get("onMissing").has_value());
+        CHECK(!Get("M.onMissing").has_value());
+        CHECK(Cache.Size() == 2);
+    }
+    SUBCASE("Notices reassigned globals") {
+        CHECK(Get("onTest")->Fn(1).get<int>() == 2);
+        State.script("function onTest(x) return x + 10 end");
+        CHECK(Get("onTest")->Fn(1).get<int>() == 11);
+        State.script("onTest = nil");
+        CHECK(!Get("onTest").has_value());
+        CHECK(Cache.Size() == 0);
+    }
+    SUBCASE("Table fields are kept until invalidated") {
+        CHECK(Get("M.onTest")->Fn(1).get<int>() == 3);
+        State.script("M.onTest = function(x) return x + 20 end");
+        CHECK(Get("M.onTest")->Fn(1).get<int>() == 3);
+        Cache.Invalidate();
+        CHECK(Get("M.onTest")->Fn(1).get<int>() == 21);
     }
-    return std::nullopt;
+    SUBCASE("Repeated lookups reuse the cached handler") {
+        for (int i = 0; i < 3; ++i) {
+            auto Handler = Get("onTest");
+            REQUIRE(Handler.has_value());
+            CHECK(Handler->WithTraceback(1).get<int>() == 2);
+        }
+        CHECK(Cache.Size() == 1);
+    }
+}
+
+TEST_CASE("MakeLuaArgs") {
+    CHECK(MakeLuaArgs() == nullptr);
+    std::unordered_map<std::string, std::string> Identifiers { { "beammp", "1234" } };
+    const auto Args = MakeLuaArgs(std::string("Player"), 5, true, Identifiers, JsonString { "[1]" });
+    REQUIRE(Args->size() == 5);
+    CHECK(std::get<std::string>(Args->at(0)) == "Player");
+    CHECK(std::get<int>(Args->at(1)) == 5);
+    CHECK(std::get<bool>(Args->at(2)));
+    CHECK(std::get<TLuaType::StringStringMap>(Args->at(3)) == Identifiers);
+    CHECK(std::get<JsonString>(Args->at(4)).value == "[1]");
+    // moved in, not copied
+    std::string Large(1000, 'x');
+    const auto* Data = Large.data();
+    CHECK(std::get<std::string>(MakeLuaArgs(std::move(Large))->at(0)).data() == Data);
 }
 
 TLuaEngine::TLuaEngine()
     : mResourceServerPath(fs::path(Application::Settings.getAsString(Settings::Key::General_ResourceFolder)) / "Server") {
+    mLuaEventRegistries.push_back(std::make_unique<const EventRegistry>());
+    mLuaEvents.store(mLuaEventRegistries.back().get(), std::memory_order_release);
     Application::SetSubsystemStatus("LuaEngine", Application::Status::Starting);
     LuaAPI::MP::Engine = this;
     if (!fs::exists(Application::Settings.getAsString(Settings::Key::General_ResourceFolder))) {
@@ -64,6 +168,11 @@ TLuaEngine::TLuaEngine()
     }
     Application::RegisterShutdownHandler([&] {
         Application::SetSubsystemStatus("LuaEngine", Application::Status::ShuttingDown);
+        {
+            // the event loop checks for shutdown while holding this, so it can't miss the wakeup
+            std::unique_lock Lock(mTimedEventsMutex);
+        }
+        mTimedEventsCond.notify_all();
         if (mThread.joinable()) {
             mThread.join();
         }
@@ -72,10 +181,38 @@ TLuaEngine::TLuaEngine()
     IThreaded::Start();
 }
 
+TLuaEngine::~TLuaEngine() noexcept {
+    // the state threads keep running during shutdown (for onShutdown), so they have to be
+    // stopped before anything they could be using is destroyed
+    std::vector<StateThreadData*> States;
+    std::unique_lock Lock(mLuaStatesMutex);
+    for (auto& [Id, State] : mLuaStates) {
+        State->Stop();
+        States.push_back(State.get());
+    }
+    Lock.unlock();
+    // not holding the lock, as the states may still need it to finish what they're doing
+    for (auto* State : States) {
+        State->Join();
+    }
+    beammp_debug("Lua Engine terminated");
+}
+
 TEST_CASE("TLuaEngine ctor & dtor") {
     Application::Settings.set(Settings::Key::General_ResourceFolder, "beammp_server_test_resources");
-    TLuaEngine engine;
-    Application::GracefullyShutdown();
+    std::shared_ptr<TLuaResult> Busy;
+    {
+        TLuaEngine engine;
+        engine.EnsureStateExists("busy", "busy", true);
+        Busy = engine.EnqueueScript("busy", TLuaChunk(std::make_shared<std::string>("local Start = os.clock() while os.clock() - Start < 0.2 do end"), "busy.lua", "busy"));
+        // once it's off the queue, the state's thread is running it
+        while (engine.Debug_GetStateFunctionQueueSizeForState("busy") > 0) {
+            std::this_thread::yield();
+        }
+        Application::GracefullyShutdown();
+    }
+    // the engine waited for the state instead of destroying it under the running script
+    CHECK(Busy->Ready.load());
 }
 
 void TLuaEngine::operator()() {
@@ -93,73 +230,19 @@ void TLuaEngine::operator()() {
         }
     }
 
-    auto ResultCheckThread = std::thread([&] {
-        RegisterThread("ResultCheckThread");
-        while (!Application::IsShuttingDown()) {
-            std::unique_lock Lock(mResultsToCheckMutex);
-            if (!mResultsToCheck.empty()) {
-                mResultsToCheck.remove_if([](const std::shared_ptr<TLuaResult>& Ptr) -> bool {
-                    if (Ptr->Ready) {
-                        if (Ptr->Error) {
-                            if (Ptr->ErrorMessage != BeamMPFnNotFoundError) {
-                                beammp_lua_error(Ptr->Function + ": " + Ptr->ErrorMessage);
-                            }
-                        }
-                        return true;
-                    }
-                    return false;
-                });
-            } else {
-                mResultsToCheckCond.wait_for(Lock, std::chrono::milliseconds(20));
-            }
-        }
-    });
-    // event loop
-    auto Before = std::chrono::high_resolution_clock::now();
+    // event loop, sleeps until the next timer is due
+    std::unique_lock Lock(mTimedEventsMutex);
     while (!Application::IsShuttingDown()) {
-        { // Timed Events Scope
-            std::unique_lock Lock(mTimedEventsMutex);
-            for (auto& Timer : mTimedEvents) {
-                if (Timer.Expired()) {
-                    auto LastCompletionBeforeReset = Timer.LastCompletion;
-                    Timer.Reset();
-                    auto Handlers = GetEventHandlersForState(Timer.EventName, Timer.StateId);
-                    std::unique_lock StateLock(mLuaStatesMutex);
-                    std::unique_lock Lock2(mResultsToCheckMutex);
-                    for (auto& Handler : Handlers) {
-                        auto Res = mLuaStates[Timer.StateId]->EnqueueFunctionCallFromCustomEvent(Handler, {}, Timer.EventName, Timer.Strategy);
-                        if (Res) {
-                            mResultsToCheck.push_back(Res);
-                            mResultsToCheckCond.notify_one();
-                        } else {
-                            // "revert" reset
-                            Timer.LastCompletion = LastCompletionBeforeReset;
-                            // beammp_trace("Reverted reset of \"" + Timer.EventName + "\" timer");
-                            // no need to try to enqueue more handlers for this event (they will all fail)
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-        if (mLuaStates.size() == 0) {
-            beammp_trace("No Lua states, event loop running extremely sparsely");
-            Application::SleepSafeSeconds(10);
+        mTimedEvents.FireDue(std::chrono::steady_clock::now(), [](const TimedEvent& Timer) {
+            return Timer.State->EnqueueTimerTick(Timer.EventName, Timer.Strategy);
+        });
+        mTimedEventsChanged = false;
+        auto ShouldWake = [this] { return mTimedEventsChanged || Application::IsShuttingDown(); };
+        if (auto NextDue = mTimedEvents.NextDue()) {
+            mTimedEventsCond.wait_until(Lock, NextDue.value(), ShouldWake);
         } else {
-            constexpr double NsFactor = 1000000.0;
-            constexpr double Expected = 10.0; // ms
-            const auto Diff = (std::chrono::high_resolution_clock::now() - Before).count() / NsFactor;
-            if (Diff < Expected) {
-                std::this_thread::sleep_for(std::chrono::nanoseconds(size_t((Expected - Diff) * NsFactor)));
-            } else {
-                beammp_tracef("Event loop cannot keep up! Running {}ms behind", Diff);
-            }
+            mTimedEventsCond.wait(Lock, ShouldWake);
         }
-        Before = std::chrono::high_resolution_clock::now();
-    }
-
-    if (ResultCheckThread.joinable()) {
-        ResultCheckThread.join();
     }
 }
 
@@ -194,54 +277,33 @@ TLuaStateId TLuaEngine::GetStateIDForPlugin(const fs::path& PluginPath) {
     return "";
 }
 
-void TLuaEngine::AddResultToCheck(const std::shared_ptr<TLuaResult>& Result) {
-    std::unique_lock Lock(mResultsToCheckMutex);
-    mResultsToCheck.push_back(Result);
-    mResultsToCheckCond.notify_one();
+size_t TLuaEngine::GetQueuedWorkCount() {
+    std::unique_lock Lock(mLuaStatesMutex);
+    size_t Count = 0;
+    for (const auto& [Id, State] : mLuaStates) {
+        Count += State->Debug_GetStateFunctionQueueSize();
+    }
+    return Count;
 }
 
 std::unordered_map<std::string /* event name */, std::vector<std::string> /* handlers */> TLuaEngine::Debug_GetEventsForState(TLuaStateId StateId) {
     std::unordered_map<std::string, std::vector<std::string>> Result;
-    std::unique_lock Lock(mLuaEventsMutex);
-    for (const auto& EventNameToEventMap : mLuaEvents) {
-        for (const auto& IdSetOfHandlersPair : EventNameToEventMap.second) {
-            if (IdSetOfHandlersPair.first == StateId) {
-                for (const auto& Handler : IdSetOfHandlersPair.second) {
-                    Result[EventNameToEventMap.first].push_back(Handler);
-                }
+    auto& Interner = TStringInterner::Global();
+    const auto StateKey = Interner.Find(StateId);
+    const auto Registry = mLuaEvents.load(std::memory_order_acquire);
+    for (const auto& [EventName, Handlers] : Registry->Events) {
+        for (const auto& Handler : Handlers) {
+            if (Handler.StateId == StateKey) {
+                Result[Interner.Get(EventName)].push_back(Interner.Get(Handler.FunctionName));
             }
         }
     }
     return Result;
 }
 
-std::queue<std::pair<TLuaChunk, std::shared_ptr<TLuaResult>>> TLuaEngine::Debug_GetStateExecuteQueueForState(TLuaStateId StateId) {
-    std::queue<std::pair<TLuaChunk, std::shared_ptr<TLuaResult>>> Result;
+size_t TLuaEngine::Debug_GetStateFunctionQueueSizeForState(TLuaStateId StateId) {
     std::unique_lock Lock(mLuaStatesMutex);
-    Result = mLuaStates.at(StateId)->Debug_GetStateExecuteQueue();
-    return Result;
-}
-
-std::vector<TLuaEngine::QueuedFunction> TLuaEngine::Debug_GetStateFunctionQueueForState(TLuaStateId StateId) {
-    std::vector<TLuaEngine::QueuedFunction> Result;
-    std::unique_lock Lock(mLuaStatesMutex);
-    Result = mLuaStates.at(StateId)->Debug_GetStateFunctionQueue();
-    return Result;
-}
-
-std::vector<TLuaResult> TLuaEngine::Debug_GetResultsToCheckForState(TLuaStateId StateId) {
-    std::unique_lock Lock(mResultsToCheckMutex);
-    auto ResultsToCheckCopy = mResultsToCheck;
-    Lock.unlock();
-    std::vector<TLuaResult> Result;
-    while (!ResultsToCheckCopy.empty()) {
-        auto ResultToCheck = std::move(ResultsToCheckCopy.front());
-        ResultsToCheckCopy.pop_front();
-        if (ResultToCheck->StateId == StateId) {
-            Result.push_back(*ResultToCheck);
-        }
-    }
-    return Result;
+    return mLuaStates.at(StateId)->Debug_GetStateFunctionQueueSize();
 }
 
 std::vector<std::string> TLuaEngine::GetStateGlobalKeysForState(TLuaStateId StateId) {
@@ -320,43 +382,84 @@ std::vector<std::string> TLuaEngine::StateThreadData::GetStateTableKeys(const st
 */
 
 void TLuaEngine::WaitForAll(std::vector<std::shared_ptr<TLuaResult>>& Results, const std::optional<std::chrono::high_resolution_clock::duration>& Max) {
+    const auto Start = std::chrono::steady_clock::now();
+    std::optional<std::chrono::steady_clock::time_point> Deadline;
+    if (Max.has_value()) {
+        Deadline = Start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(Max.value());
+    }
+    const auto WarnAt = Start + std::chrono::minutes(1);
+    // Waiting on each result in turn returns right when the last one is done,
+    // since the ones which finished earlier don't block at all.
     for (const auto& Result : Results) {
         bool Cancelled = false;
-        size_t ms = 0;
-        std::set<std::string> WarnedResults;
-
-        while (!Result->Ready && !Cancelled) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            ms += 10;
-            if (Max.has_value() && std::chrono::milliseconds(ms) > Max.value()) {
-                beammp_trace("'" + Result->Function + "' in '" + Result->StateId + "' did not finish executing in time (took: " + std::to_string(ms) + "ms).");
+        bool Warned = false;
+        for (;;) {
+            if (!Deadline.has_value() && Warned) {
+                Result->WaitUntilReady();
+                break;
+            }
+            auto WakeAt = Deadline.value_or(WarnAt);
+            if (!Warned) {
+                WakeAt = std::min(WakeAt, WarnAt);
+            }
+            if (Result->WaitUntilReady(WakeAt)) {
+                break;
+            }
+            const auto Now = std::chrono::steady_clock::now();
+            if (Deadline.has_value() && Now >= Deadline.value()) {
+                beammp_tracef("'{}' in '{}' did not finish executing in time (took: {}ms).", Result->Function, Result->StateId, std::chrono::duration_cast<std::chrono::milliseconds>(Now - Start).count());
                 Cancelled = true;
-            } else if (ms > 1000 * 60) {
-                auto ResultId = Result->StateId + "_" + Result->Function;
-                if (WarnedResults.count(ResultId) == 0) {
-                    WarnedResults.insert(ResultId);
-                    beammp_lua_warn("'" + Result->Function + "' in '" + Result->StateId + "' is taking very long. The event it's handling is too important to discard the result of this handler, but may block this event and possibly the whole lua state.");
-                }
+                break;
+            } else if (!Warned && Now >= WarnAt) {
+                Warned = true;
+                beammp_lua_warn("'" + Result->Function + "' in '" + Result->StateId + "' is taking very long. The event it's handling is too important to discard the result of this handler, but may block this event and possibly the whole lua state.");
             }
         }
 
         if (Cancelled) {
             beammp_lua_warn("'" + Result->Function + "' in '" + Result->StateId + "' failed to execute in time and was not waited for. It may still finish executing at a later time.");
-            LuaAPI::MP::Engine->ReportErrors({ Result });
-        } else if (Result->Error) {
-            if (Result->ErrorMessage != BeamMPFnNotFoundError) {
-                beammp_lua_error(Result->Function + ": " + Result->ErrorMessage);
-            }
         }
+        Result->ReportErrorOnCompletion();
     }
 }
 
-// run this on the error checking thread
+TEST_CASE("TLuaEngine::WaitForAll") {
+    std::vector<std::shared_ptr<TLuaResult>> Results;
+    for (size_t i = 0; i < 8; ++i) {
+        Results.push_back(TLuaResult::Create());
+    }
+    std::thread Completer([Results] {
+        // complete them in reverse, so that the waiter has to wait on every one of them
+        for (auto Iter = Results.rbegin(); Iter != Results.rend(); ++Iter) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            (*Iter)->Error = false;
+            (*Iter)->MarkAsReady();
+        }
+    });
+    const auto Start = std::chrono::steady_clock::now();
+    TLuaEngine::WaitForAll(Results, std::chrono::seconds(10));
+    const auto Took = std::chrono::steady_clock::now() - Start;
+    Completer.join();
+    for (const auto& Result : Results) {
+        CHECK(Result->Ready);
+    }
+    CHECK(Took < std::chrono::seconds(10));
+
+    // the deadline is for all of them together, not for each, which would take 5s here
+    std::vector<std::shared_ptr<TLuaResult>> NeverReady;
+    for (size_t i = 0; i < 100; ++i) {
+        NeverReady.push_back(TLuaResult::Create());
+    }
+    const auto DeadlineStart = std::chrono::steady_clock::now();
+    TLuaEngine::WaitForAll(NeverReady, std::chrono::milliseconds(50));
+    const auto DeadlineTook = std::chrono::steady_clock::now() - DeadlineStart;
+    CHECK(DeadlineTook >= std::chrono::milliseconds(50));
+    CHECK(DeadlineTook < std::chrono::seconds(4));
+}
+
 void TLuaEngine::ReportErrors(const std::vector<std::shared_ptr<TLuaResult>>& Results) {
-    std::unique_lock Lock2(mResultsToCheckMutex);
     for (const auto& Result : Results) {
-        mResultsToCheck.push_back(Result);
-        mResultsToCheckCond.notify_one();
+        Result->ReportErrorOnCompletion();
     }
 }
 
@@ -370,9 +473,10 @@ std::shared_ptr<TLuaResult> TLuaEngine::EnqueueScript(TLuaStateId StateID, const
     return mLuaStates.at(StateID)->EnqueueScript(Script);
 }
 
-std::shared_ptr<TLuaResult> TLuaEngine::EnqueueFunctionCall(TLuaStateId StateID, const std::string& FunctionName, const std::vector<TLuaValue>& Args, const std::string& EventName) {
+std::shared_ptr<TLuaResult> TLuaEngine::EnqueueFunctionCall(TLuaStateId StateID, const std::string& FunctionName, const TLuaArgs& Args, const std::string& EventName) {
     std::unique_lock Lock(mLuaStatesMutex);
-    return mLuaStates.at(StateID)->EnqueueFunctionCall(FunctionName, Args, EventName);
+    auto& Interner = TStringInterner::Global();
+    return mLuaStates.at(StateID)->EnqueueFunctionCall(Interner.Intern(FunctionName), Args, Interner.Intern(EventName));
 }
 
 void TLuaEngine::CollectAndInitPlugins() {
@@ -442,8 +546,9 @@ void TLuaEngine::EnsureStateExists(TLuaStateId StateId, const std::string& Name,
     if (mLuaStates.find(StateId) == mLuaStates.end()) {
         beammp_debug("Creating lua state for state id \"" + StateId + "\"");
         auto DataPtr = std::make_unique<StateThreadData>(Name, StateId, *this);
+        auto& State = *DataPtr;
         mLuaStates[StateId] = std::move(DataPtr);
-        RegisterEvent("onInit", StateId, "onInit");
+        RegisterEvent("onInit", State, "onInit");
         if (!DontCallOnInit) {
             auto Res = EnqueueFunctionCall(StateId, "onInit", {}, "onInit");
             Res->WaitUntilReady();
@@ -454,16 +559,55 @@ void TLuaEngine::EnsureStateExists(TLuaStateId StateId, const std::string& Name,
     }
 }
 
-void TLuaEngine::RegisterEvent(const std::string& EventName, TLuaStateId StateId, const std::string& FunctionName) {
+void TLuaEngine::RegisterEvent(const std::string& EventName, StateThreadData& State, const std::string& FunctionName) {
+    auto& Interner = TStringInterner::Global();
+    const auto EventId = Interner.Intern(EventName);
+    const auto StateId = State.InternedStateId();
+    const auto FunctionId = Interner.Intern(FunctionName);
     std::unique_lock Lock(mLuaEventsMutex);
-    mLuaEvents[EventName][StateId].insert(FunctionName);
+    const auto Current = mLuaEvents.load(std::memory_order_acquire);
+    auto Iter = Current->Events.find(EventId);
+    const auto Key = std::tie(Interner.Get(StateId), FunctionName);
+    auto Less = [&Interner](const EventRegistry::Handler& Handler, const decltype(Key)& Other) {
+        return std::tie(Interner.Get(Handler.StateId), Interner.Get(Handler.FunctionName)) < Other;
+    };
+    if (Iter != Current->Events.end()) {
+        auto Existing = std::lower_bound(Iter->second.begin(), Iter->second.end(), Key, Less);
+        if (Existing != Iter->second.end() && Existing->StateId == StateId && Existing->FunctionName == FunctionId) {
+            // already registered, nothing changes
+            return;
+        }
+    }
+    auto New = std::make_unique<EventRegistry>(*Current);
+    auto& Handlers = New->Events[EventId];
+    Handlers.insert(std::lower_bound(Handlers.begin(), Handlers.end(), Key, Less), EventRegistry::Handler { StateId, &State, FunctionId });
+    ++New->HandlerCount;
+    mLuaEvents.store(New.get(), std::memory_order_release);
+    mLuaEventRegistries.push_back(std::move(New));
 }
 
-std::set<std::string> TLuaEngine::GetEventHandlersForState(const std::string& EventName, TLuaStateId StateId) {
-    return mLuaEvents[EventName][StateId];
+std::vector<TStringId> TLuaEngine::GetEventHandlersForState(TStringId EventName, TStringId StateId) {
+    std::vector<TStringId> Result;
+    const auto Registry = mLuaEvents.load(std::memory_order_acquire);
+    auto Iter = Registry->Events.find(EventName);
+    if (Iter != Registry->Events.end()) {
+        for (const auto& Handler : Iter->second) {
+            if (Handler.StateId == StateId) {
+                Result.push_back(Handler.FunctionName);
+            }
+        }
+    }
+    return Result;
 }
 
-std::vector<sol::object> TLuaEngine::StateThreadData::JsonStringToArray(JsonString Str) {
+std::vector<TStringId> TLuaEngine::GetEventHandlersForState(const std::string& EventName, TStringId StateId) {
+    if (auto EventId = TStringInterner::Global().Find(EventName)) {
+        return GetEventHandlersForState(EventId.value(), StateId);
+    }
+    return {};
+}
+
+std::vector<sol::object> TLuaEngine::StateThreadData::JsonStringToArray(const JsonString& Str) {
     auto LocalTable = Lua_JsonDecode(Str.value).as<std::vector<sol::object>>();
     for (auto& value : LocalTable) {
         if (value.is<std::string>() && value.as<std::string>() == BEAMMP_INTERNAL_NIL) {
@@ -502,17 +646,14 @@ sol::table TLuaEngine::StateThreadData::Lua_TriggerGlobalEvent(const std::string
     JsonString Str { LuaAPI::MP::JsonEncode(Table) };
     beammp_debugf("json: {}", Str.value);
     auto Return = mEngine->TriggerEvent(EventName, mStateId, Str);
-    auto MyHandlers = mEngine->GetEventHandlersForState(EventName, mStateId);
+    auto MyHandlers = mEngine->GetEventHandlersForState(EventName, mInternedStateId);
 
     sol::variadic_results LocalArgs = JsonStringToArray(Str);
     for (const auto& Handler : MyHandlers) {
-        auto Res = GetLuaHandler(mStateView, Handler, EventName);
+        auto Res = mHandlerCache.Get(mStateView, Handler, EventName);
         if (Res.has_value()) {
-            sol::function Fn = Res.value();
-            Fn = AddTraceback(mStateView, Fn);
-
-            auto LuaResult = Fn(LocalArgs);
-            auto Result = std::make_shared<TLuaResult>();
+            auto LuaResult = Res->WithTraceback(LocalArgs);
+            auto Result = TLuaResult::Create();
             if (LuaResult.valid()) {
                 Result->Error = false;
                 Result->Result = LuaResult;
@@ -520,7 +661,7 @@ sol::table TLuaEngine::StateThreadData::Lua_TriggerGlobalEvent(const std::string
                 Result->Error = true;
                 sol::error Err = LuaResult;
                 Result->ErrorMessage = Err.what();
-                beammp_errorf("An error occured while executing local event handler \"{}\" for event \"{}\": {}", Handler, EventName, Result->ErrorMessage);
+                beammp_errorf("An error occured while executing local event handler \"{}\" for event \"{}\": {}", TStringInterner::Global().Get(Handler), EventName, Result->ErrorMessage);
             }
             Result->MarkAsReady();
             Return.push_back(Result);
@@ -561,11 +702,10 @@ sol::table TLuaEngine::StateThreadData::Lua_TriggerLocalEvent(const std::string&
     // TODO: make asynchronous?
     sol::table Result = mStateView.create_table();
     int i = 1;
-    for (const auto& Handler : mEngine->GetEventHandlersForState(EventName, mStateId)) {
-        auto Res = GetLuaHandler(mStateView, Handler, EventName);
+    for (const auto& Handler : mEngine->GetEventHandlersForState(EventName, mInternedStateId)) {
+        auto Res = mHandlerCache.Get(mStateView, Handler, EventName);
         if (Res.has_value()) {
-            sol::function Fn = Res.value();
-            auto FnRet = Fn(EventArgs);
+            auto FnRet = Res->Fn(EventArgs);
             if (FnRet.valid()) {
                 Result.set(i, FnRet);
                 ++i;
@@ -682,7 +822,7 @@ sol::table TLuaEngine::StateThreadData::Lua_GetPlayerVehicles(int ID) {
         sol::state_view StateView(mState);
         sol::table Result = StateView.create_table();
         for (const auto& v : VehicleData) {
-            Result[v.ID()] = v.Data().substr(3);
+            Result[v.ID()] = std::string_view(*v.Data()).substr(3);
         }
         return Result;
     } else
@@ -821,6 +961,7 @@ sol::table TLuaEngine::StateThreadData::Lua_JsonDecode(const std::string& str) {
 TLuaEngine::StateThreadData::StateThreadData(const std::string& Name, TLuaStateId StateId, TLuaEngine& Engine)
     : mName(Name)
     , mStateId(StateId)
+    , mInternedStateId(TStringInterner::Global().Intern(StateId))
     , mState(luaL_newstate())
     , mEngine(&Engine) {
     if (!mState) {
@@ -926,7 +1067,7 @@ TLuaEngine::StateThreadData::StateThreadData(const std::string& Name, TLuaStateI
         if (IntervalMS < 25) {
             beammp_warn("Timer for \"" + EventName + "\" on \"" + mStateId + "\" is set to trigger at <25ms, which is likely too fast and won't cancel properly.");
         }
-        mEngine->CreateEventTimer(EventName, mStateId, IntervalMS, Strategy);
+        mEngine->CreateEventTimer(EventName, *this, IntervalMS, Strategy);
     });
     MPTable.set_function("CancelEventTimer", [&](const std::string& EventName) {
         mEngine->CancelEventTimers(EventName, mStateId);
@@ -991,6 +1132,9 @@ TLuaEngine::StateThreadData::StateThreadData(const std::string& Name, TLuaStateI
         sol::state_view StateView(mState);
         sol::table Result = StateView.create_table();
         auto stats = mProfile.all_stats();
+        for (const auto& [Handler, Time] : mHandlerProfile) {
+            stats.try_emplace(TStringInterner::Global().Get(Handler), Time.stats());
+        }
         for (const auto& [name, stat] : stats) {
             Result[name] = StateView.create_table();
             Result[name]["mean"] = stat.mean;
@@ -1052,46 +1196,37 @@ TLuaEngine::StateThreadData::StateThreadData(const std::string& Name, TLuaStateI
 }
 
 std::shared_ptr<TLuaResult> TLuaEngine::StateThreadData::EnqueueScript(const TLuaChunk& Script) {
-    std::unique_lock Lock(mStateExecuteQueueMutex);
-    auto Result = std::make_shared<TLuaResult>();
-    mStateExecuteQueue.push({ Script, Result });
+    auto Result = TLuaResult::Create();
+    mWorkQueue.Push(QueuedScript { Script, Result });
     return Result;
 }
 
-std::shared_ptr<TLuaResult> TLuaEngine::StateThreadData::EnqueueFunctionCallFromCustomEvent(const std::string& FunctionName, const std::vector<TLuaValue>& Args, const std::string& EventName, CallStrategy Strategy) {
-    // TODO: Document all this
-    decltype(mStateFunctionQueue)::iterator Iter = mStateFunctionQueue.end();
+bool TLuaEngine::StateThreadData::EnqueueTimerTick(TStringId EventName, CallStrategy Strategy) {
+    // BestEffort timers skip a tick while the previous one is still queued,
+    // so that a slow state doesn't build up a backlog of them
     if (Strategy == CallStrategy::BestEffort) {
-        Iter = std::find_if(mStateFunctionQueue.begin(), mStateFunctionQueue.end(),
-            [&EventName](const QueuedFunction& Element) {
-                return Element.EventName == EventName;
-            });
-    }
-    if (Iter == mStateFunctionQueue.end()) {
-        auto Result = std::make_shared<TLuaResult>();
-        Result->StateId = mStateId;
-        Result->Function = FunctionName;
-        std::unique_lock Lock(mStateFunctionQueueMutex);
-        mStateFunctionQueue.push_back({ FunctionName, Result, Args, EventName });
-        mStateFunctionQueueCond.notify_all();
-        return Result;
-    } else {
-        return nullptr;
+        std::unique_lock Lock(mBestEffortQueuedMutex);
+        auto& Queued = mBestEffortQueued[EventName];
+        if (Queued > 0) {
+            return false;
+        }
+        ++Queued;
     }
+    mWorkQueue.Push(QueuedTimerTick { EventName, Strategy });
+    return true;
 }
 
-std::shared_ptr<TLuaResult> TLuaEngine::StateThreadData::EnqueueFunctionCall(const std::string& FunctionName, const std::vector<TLuaValue>& Args, const std::string& EventName) {
-    auto Result = std::make_shared<TLuaResult>();
+std::shared_ptr<TLuaResult> TLuaEngine::StateThreadData::EnqueueFunctionCall(TStringId FunctionName, const TLuaArgs& Args, TStringId EventName) {
+    auto Result = TLuaResult::Create();
     Result->StateId = mStateId;
-    Result->Function = FunctionName;
-    std::unique_lock Lock(mStateFunctionQueueMutex);
-    mStateFunctionQueue.push_back({ FunctionName, Result, Args, EventName });
-    mStateFunctionQueueCond.notify_all();
+    Result->Function = TStringInterner::Global().Get(FunctionName);
+    mWorkQueue.Push(QueuedFunction { FunctionName, Result, Args, EventName });
     return Result;
 }
 
 void TLuaEngine::StateThreadData::RegisterEvent(const std::string& EventName, const std::string& FunctionName) {
-    mEngine->RegisterEvent(EventName, mStateId, FunctionName);
+    mHandlerCache.Invalidate();
+    mEngine->RegisterEvent(EventName, *this, FunctionName);
 }
 
 static sol::protected_function AddTraceback(sol::state_view StateView, sol::protected_function RawFn) {
@@ -1109,201 +1244,318 @@ static sol::protected_function AddTraceback(sol::state_view StateView, sol::prot
     return sol::protected_function(RawFn, StateView["INTERNAL_ERROR_HANDLER"]);
 }
 
+template <class... Ts>
+struct overloaded : Ts... {
+    using Ts::operator()...;
+};
+template <class... Ts>
+overloaded(Ts...) -> overloaded<Ts...>;
+
 void TLuaEngine::StateThreadData::operator()() {
     RegisterThread("Lua:" + mStateId);
-    while (!Application::IsShuttingDown()) {
-        { // StateExecuteQueue Scope
-            std::unique_lock Lock(mStateExecuteQueueMutex);
-            if (!mStateExecuteQueue.empty()) {
-                auto S = mStateExecuteQueue.front();
-                mStateExecuteQueue.pop();
-                Lock.unlock();
-
-                { // Paths Scope
-                    std::unique_lock Lock(mPathsMutex);
-                    if (!mPaths.empty()) {
-                        std::stringstream PathAdditions;
-                        std::stringstream CPathAdditions;
-                        while (!mPaths.empty()) {
-                            auto Path = mPaths.front();
-                            mPaths.pop();
-                            PathAdditions << ";" << (Path / "?.lua").string();
-                            PathAdditions << ";" << (Path / "lua/?.lua").string();
+    std::vector<QueuedWork> Batch;
+    while (!mStopping) {
+        mWorkQueue.WaitForItems();
+        constexpr size_t MaxBatchSize = 256;
+        mWorkQueue.PopBatch(Batch, MaxBatchSize);
+        for (auto& Work : Batch) {
+            if (mStopping) {
+                break;
+            }
+            std::visit(
+                overloaded {
+                    [](std::monostate) { },
+                    [this](QueuedScript& Script) { ExecuteScript(Script); },
+                    [this](QueuedFunction& Function) { CallQueuedFunction(Function); },
+                    [this](QueuedTimerTick& Tick) { CallTimerHandlers(Tick); },
+                    [this](QueuedPath& Path) { AddToPackagePaths(Path.Path); },
+                },
+                Work);
+        }
+        Batch.clear();
+        // lets Lua collect the arguments' tables
+        mConvertedArgs.reset();
+        mConvertedLuaArgs.clear();
+    }
+}
+
+void TLuaEngine::StateThreadData::Stop() {
+    mStopping = true;
+    mWorkQueue.Push(std::monostate {});
+}
+
+void TLuaEngine::StateThreadData::Join() {
+    // IThreaded::mThread, which Start() launched
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+}
+
+void TLuaEngine::StateThreadData::AddToPackagePaths(const fs::path& Path) {
+    std::string PathAdditions = ";" + (Path / "?.lua").string() + ";" + (Path / "lua/?.lua").string();
 #if WIN32
-                            CPathAdditions << ";" << (Path / "?.dll").string();
-                            CPathAdditions << ";" << (Path / "lib/?.dll").string();
+    std::string CPathAdditions = ";" + (Path / "?.dll").string() + ";" + (Path / "lib/?.dll").string();
 #else // unix
-                            CPathAdditions << ";" << (Path / "?.so").string();
-                            CPathAdditions << ";" << (Path / "lib/?.so").string();
+    std::string CPathAdditions = ";" + (Path / "?.so").string() + ";" + (Path / "lib/?.so").string();
 #endif
-                        }
-                        sol::state_view StateView(mState);
-                        auto PackageTable = StateView.globals().get<sol::table>("package");
-                        PackageTable["path"] = PackageTable.get<std::string>("path") + PathAdditions.str();
-                        PackageTable["cpath"] = PackageTable.get<std::string>("cpath") + CPathAdditions.str();
-                        StateView.globals()["package"] = PackageTable;
-                    }
-                }
-                sol::state_view StateView(mState);
-                auto Res = StateView.safe_script(*S.first.Content, sol::script_pass_on_error, S.first.FileName);
-                if (Res.valid()) {
-                    S.second->Error = false;
-                    S.second->Result = std::move(Res);
-                } else {
-                    S.second->Error = true;
-                    sol::error Err = Res;
-                    S.second->ErrorMessage = Err.what();
-                }
-                S.second->MarkAsReady();
-            }
+    auto PackageTable = mStateView.globals().get<sol::table>("package");
+    PackageTable["path"] = PackageTable.get<std::string>("path") + PathAdditions;
+    PackageTable["cpath"] = PackageTable.get<std::string>("cpath") + CPathAdditions;
+}
+
+void TLuaEngine::StateThreadData::ExecuteScript(QueuedScript& Script) {
+    auto Res = mStateView.safe_script(*Script.Chunk.Content, sol::script_pass_on_error, Script.Chunk.FileName);
+    // the chunk may have (re)defined any handler, e.g. on hot reload
+    mHandlerCache.Invalidate();
+    if (Res.valid()) {
+        Script.Result->Error = false;
+        Script.Result->Result = std::move(Res);
+    } else {
+        Script.Result->Error = true;
+        sol::error Err = Res;
+        Script.Result->ErrorMessage = Err.what();
+    }
+    Script.Result->MarkAsReady();
+}
+
+void TLuaEngine::StateThreadData::CallTimerHandlers(const QueuedTimerTick& Tick) {
+    if (Tick.Strategy == CallStrategy::BestEffort) {
+        std::unique_lock Lock(mBestEffortQueuedMutex);
+        --mBestEffortQueued[Tick.EventName];
+    }
+    for (const auto& Handler : mEngine->GetEventHandlersForState(Tick.EventName, mInternedStateId)) {
+        QueuedFunction Function { Handler, TLuaResult::Create(), {}, Tick.EventName };
+        Function.Result->Function = TStringInterner::Global().Get(Handler);
+        Function.Result->ReportErrorOnCompletion();
+        CallQueuedFunction(Function);
+    }
+}
+
+const std::vector<sol::object>& TLuaEngine::StateThreadData::ToLuaArgs(const TLuaArgs& Args) {
+    if (Args == mConvertedArgs) {
+        return mConvertedLuaArgs;
+    }
+    mConvertedArgs = Args;
+    mConvertedLuaArgs.clear();
+    if (!Args) {
+        return mConvertedLuaArgs;
+    }
+    for (const auto& Arg : *Args) {
+        if (Arg.valueless_by_exception()) {
+            continue;
         }
-        { // StateFunctionQueue Scope
-            std::unique_lock Lock(mStateFunctionQueueMutex);
-            auto NotExpired = mStateFunctionQueueCond.wait_for(Lock,
-                std::chrono::milliseconds(500),
-                [&]() -> bool { return !mStateFunctionQueue.empty(); });
-            if (NotExpired) {
-                auto ProfStart = prof::now();
-                auto TheQueuedFunction = std::move(mStateFunctionQueue.front());
-                mStateFunctionQueue.erase(mStateFunctionQueue.begin());
-                Lock.unlock();
-                auto& FnName = TheQueuedFunction.FunctionName;
-                auto& Result = TheQueuedFunction.Result;
-                auto Args = TheQueuedFunction.Args;
-                // TODO: Use TheQueuedFunction.EventName for errors, warnings, etc
-                Result->StateId = mStateId;
-                sol::state_view StateView(mState);
-
-                auto Res = GetLuaHandler(StateView, FnName, TheQueuedFunction.EventName);
-                if (Res.has_value()) {
-                    sol::function Fn = Res.value();
-                    std::vector<sol::object> LuaArgs;
-                    for (const auto& Arg : Args) {
-                        if (Arg.valueless_by_exception()) {
-                            continue;
-                        }
-                        switch (Arg.index()) {
-                        case TLuaType::String:
-                            LuaArgs.push_back(sol::make_object(StateView, std::get<std::string>(Arg)));
-                            break;
-                        case TLuaType::Int:
-                            LuaArgs.push_back(sol::make_object(StateView, std::get<int>(Arg)));
-                            break;
-                        case TLuaType::Json: {
-                            auto LocalArgs = JsonStringToArray(std::get<JsonString>(Arg));
-                            LuaArgs.insert(LuaArgs.end(), LocalArgs.begin(), LocalArgs.end());
-                            break;
-                        }
-                        case TLuaType::Bool:
-                            LuaArgs.push_back(sol::make_object(StateView, std::get<bool>(Arg)));
-                            break;
-                        case TLuaType::StringStringMap: {
-                            auto Map = std::get<std::unordered_map<std::string, std::string>>(Arg);
-                            auto Table = StateView.create_table();
-                            for (const auto& [k, v] : Map) {
-                                Table[k] = v;
-                            }
-                            LuaArgs.push_back(sol::make_object(StateView, Table));
-                            break;
-                        }
-                        default:
-                            beammp_error("Unknown argument type, passed as nil");
-                            break;
-                        }
-                    }
-                    Fn = AddTraceback(StateView, Fn);
-                    auto Res = Fn(sol::as_args(LuaArgs));
-                    if (Res.valid()) {
-                        Result->Error = false;
-                        Result->Result = std::move(Res);
-                    } else {
-                        Result->Error = true;
-                        sol::error Err = Res;
-                        Result->ErrorMessage = Err.what();
-                    }
-                    Result->MarkAsReady();
-                } else {
-                    Result->Error = true;
-                    Result->ErrorMessage = BeamMPFnNotFoundError; // special error kind that we can ignore later
-                    Result->MarkAsReady();
-                }
-                auto ProfEnd = prof::now();
-                auto ProfDuration = prof::duration(ProfStart, ProfEnd);
-                mProfile.add_sample(FnName, ProfDuration);
+        switch (Arg.index()) {
+        case TLuaType::String:
+            mConvertedLuaArgs.push_back(sol::make_object(mStateView, std::get<std::string>(Arg)));
+            break;
+        case TLuaType::Int:
+            mConvertedLuaArgs.push_back(sol::make_object(mStateView, std::get<int>(Arg)));
+            break;
+        case TLuaType::Json: {
+            auto LocalArgs = JsonStringToArray(std::get<JsonString>(Arg));
+            mConvertedLuaArgs.insert(mConvertedLuaArgs.end(), LocalArgs.begin(), LocalArgs.end());
+            break;
+        }
+        case TLuaType::Bool:
+            mConvertedLuaArgs.push_back(sol::make_object(mStateView, std::get<bool>(Arg)));
+            break;
+        case TLuaType::StringStringMap: {
+            const auto& Map = std::get<std::unordered_map<std::string, std::string>>(Arg);
+            auto Table = mStateView.create_table(0, int(Map.size()));
+            for (const auto& [k, v] : Map) {
+                Table[k] = v;
             }
+            mConvertedLuaArgs.push_back(sol::make_object(mStateView, Table));
+            break;
+        }
+        default:
+            beammp_error("Unknown argument type, passed as nil");
+            break;
         }
     }
+    return mConvertedLuaArgs;
 }
 
-std::queue<std::pair<TLuaChunk, std::shared_ptr<TLuaResult>>> TLuaEngine::StateThreadData::Debug_GetStateExecuteQueue() {
-    std::unique_lock Lock(mStateExecuteQueueMutex);
-    return mStateExecuteQueue;
-}
+void TLuaEngine::StateThreadData::CallQueuedFunction(QueuedFunction& TheQueuedFunction) {
+    auto ProfStart = prof::now();
+    auto& FnName = TheQueuedFunction.FunctionName;
+    auto& Result = TheQueuedFunction.Result;
+    const auto& Args = TheQueuedFunction.Args;
+    // TODO: Use TheQueuedFunction.EventName for errors, warnings, etc
+    Result->StateId = mStateId;
+    sol::state_view StateView(mState);
 
-std::vector<TLuaEngine::QueuedFunction> TLuaEngine::StateThreadData::Debug_GetStateFunctionQueue() {
-    std::unique_lock Lock(mStateFunctionQueueMutex);
-    return mStateFunctionQueue;
+    auto Handler = mHandlerCache.Get(StateView, FnName, TStringInterner::Global().Get(TheQueuedFunction.EventName));
+    if (Handler.has_value()) {
+        auto Res = Handler->WithTraceback(sol::as_args(ToLuaArgs(Args)));
+        if (Res.valid()) {
+            Result->Error = false;
+            Result->Result = std::move(Res);
+        } else {
+            Result->Error = true;
+            sol::error Err = Res;
+            Result->ErrorMessage = Err.what();
+        }
+        Result->MarkAsReady();
+    } else {
+        Result->Error = true;
+        Result->ErrorMessage = BeamMPFnNotFoundError; // special error kind that we can ignore later
+        Result->MarkAsReady();
+    }
+    auto ProfEnd = prof::now();
+    auto ProfDuration = prof::duration(ProfStart, ProfEnd);
+    mHandlerProfile[FnName].add_sample(ProfDuration);
 }
 
-void TLuaEngine::CreateEventTimer(const std::string& EventName, TLuaStateId StateId, size_t IntervalMS, CallStrategy Strategy) {
+void TLuaEngine::CreateEventTimer(const std::string& EventName, StateThreadData& State, size_t IntervalMS, CallStrategy Strategy) {
+    auto& Interner = TStringInterner::Global();
     std::unique_lock Lock(mTimedEventsMutex);
-    TimedEvent Event {
-        std::chrono::high_resolution_clock::duration { std::chrono::milliseconds(IntervalMS) },
-        std::chrono::high_resolution_clock::now(),
-        EventName,
-        StateId,
-        Strategy
-    };
-    mTimedEvents.push_back(std::move(Event));
-    beammp_trace("created event timer for \"" + EventName + "\" on \"" + StateId + "\" with " + std::to_string(IntervalMS) + "ms interval");
+    mTimedEvents.Add(TimedEvent { Interner.Intern(EventName), State.InternedStateId(), &State, Strategy }, std::chrono::milliseconds(IntervalMS));
+    mTimedEventsChanged = true;
+    mTimedEventsCond.notify_all();
+    beammp_trace("created event timer for \"" + EventName + "\" on \"" + Interner.Get(State.InternedStateId()) + "\" with " + std::to_string(IntervalMS) + "ms interval");
 }
 
 void TLuaEngine::CancelEventTimers(const std::string& EventName, TLuaStateId StateId) {
+    auto& Interner = TStringInterner::Global();
+    const auto EventId = Interner.Find(EventName);
+    const auto StateKey = Interner.Find(StateId);
     std::unique_lock Lock(mTimedEventsMutex);
     beammp_trace("cancelling event timer for \"" + EventName + "\" on \"" + StateId + "\"");
-    for (;;) {
-        auto Iter = std::find_if(mTimedEvents.begin(), mTimedEvents.end(), [&](const TimedEvent& Event) -> bool {
-            return Event.EventName == EventName && Event.StateId == StateId;
-        });
-        if (Iter != mTimedEvents.end()) {
-            mTimedEvents.erase(Iter);
-        } else {
-            break;
-        }
+    if (!EventId || !StateKey) {
+        // never interned, so there can't be a timer for it
+        return;
     }
+    mTimedEvents.RemoveIf([&](const TimedEvent& Event) {
+        return Event.EventName == EventId.value() && Event.StateId == StateKey.value();
+    });
+}
+
+std::vector<TLuaEngine::TimerInfo> TLuaEngine::Debug_GetTimersForState(TLuaStateId StateId) {
+    std::vector<TimerInfo> Result;
+    auto& Interner = TStringInterner::Global();
+    const auto StateKey = Interner.Find(StateId);
+    std::unique_lock Lock(mTimedEventsMutex);
+    mTimedEvents.ForEach([&](const TTimerQueue<TimedEvent>::TTimer& Timer) {
+        if (Timer.Data.StateId == StateKey) {
+            Result.push_back({
+                Interner.Get(Timer.Data.EventName),
+                std::chrono::duration_cast<std::chrono::milliseconds>(Timer.Interval),
+                Timer.Stats.Fired,
+                Timer.Stats.Skipped,
+                std::chrono::duration_cast<std::chrono::microseconds>(Timer.Stats.AverageDrift()),
+                std::chrono::duration_cast<std::chrono::microseconds>(Timer.Stats.MaxDrift),
+            });
+        }
+    });
+    return Result;
 }
 
 void TLuaEngine::StateThreadData::AddPath(const fs::path& Path) {
-    std::unique_lock Lock(mPathsMutex);
-    mPaths.push(Path);
+    mWorkQueue.Push(QueuedPath { Path });
+}
+
+namespace {
+// Threads waiting for a TLuaResult sleep on one of these, picked by the result's address,
+// so that results don't need a mutex and condition variable each (like futexes do it).
+struct TResultParkingSlot {
+    std::mutex Mutex;
+    std::condition_variable Condition;
+};
+TResultParkingSlot& ParkingSlotFor(const TLuaResult* Result) {
+    static std::array<TResultParkingSlot, 64> Slots;
+    return Slots[(reinterpret_cast<uintptr_t>(Result) / alignof(TLuaResult)) % Slots.size()];
+}
+}
+
+std::shared_ptr<TLuaResult> TLuaResult::Create() {
+    return std::allocate_shared<TLuaResult>(TPoolAllocator<TLuaResult> {});
 }
 
 void TLuaResult::MarkAsReady() {
-    {
-        std::lock_guard<std::mutex> readyLock(*this->ReadyMutex);
-        this->Ready = true;
+    Ready.store(true, std::memory_order_seq_cst);
+    // seq_cst, so that either a waiter (or ReportErrorOnCompletion) sees Ready, or it is seen here
+    if (mReportRequested.load(std::memory_order_seq_cst)) {
+        ReportError();
+    }
+    if (mWaiters.load(std::memory_order_seq_cst) > 0) {
+        auto& Slot = ParkingSlotFor(this);
+        std::unique_lock Lock(Slot.Mutex);
+        Slot.Condition.notify_all();
+    }
+}
+
+void TLuaResult::ReportErrorOnCompletion() {
+    mReportRequested.store(true, std::memory_order_seq_cst);
+    if (Ready.load(std::memory_order_seq_cst)) {
+        ReportError();
+    }
+}
+
+void TLuaResult::ReportError() {
+    // both MarkAsReady() and ReportErrorOnCompletion() may get here for the same result
+    if (mReported.exchange(true)) {
+        return;
+    }
+    if (Error && ErrorMessage != TLuaEngine::BeamMPFnNotFoundError) {
+        beammp_lua_error(Function + ": " + ErrorMessage);
     }
-    this->ReadyCondition->notify_all();
 }
 
 void TLuaResult::WaitUntilReady() {
-    std::unique_lock readyLock(*this->ReadyMutex);
-    // wait if not ready yet
-    if (!this->Ready)
-        this->ReadyCondition->wait(readyLock);
+    if (Ready) {
+        return;
+    }
+    auto& Slot = ParkingSlotFor(this);
+    std::unique_lock Lock(Slot.Mutex);
+    ++mWaiters;
+    Slot.Condition.wait(Lock, [this] { return Ready.load(); });
+    --mWaiters;
 }
 
-TLuaChunk::TLuaChunk(std::shared_ptr<std::string> Content, std::string FileName, std::string PluginPath)
-    : Content(Content)
-    , FileName(FileName)
-    , PluginPath(PluginPath) {
+bool TLuaResult::WaitUntilReady(std::chrono::steady_clock::time_point Deadline) {
+    if (Ready) {
+        return true;
+    }
+    auto& Slot = ParkingSlotFor(this);
+    std::unique_lock Lock(Slot.Mutex);
+    ++mWaiters;
+    bool IsReady = Slot.Condition.wait_until(Lock, Deadline, [this] { return Ready.load(); });
+    --mWaiters;
+    return IsReady;
 }
 
-bool TLuaEngine::TimedEvent::Expired() {
-    auto Waited = (std::chrono::high_resolution_clock::now() - LastCompletion);
-    return Waited >= Duration;
+TEST_CASE("TLuaResult::Create") {
+    auto First = TLuaResult::Create();
+    CHECK(!First->Ready);
+    CHECK(!First->Error);
+    First->Error = true;
+    First->MarkAsReady();
+    First.reset();
+    // a recycled block doesn't carry over the previous result's state
+    auto Second = TLuaResult::Create();
+    CHECK(!Second->Ready);
+    CHECK(!Second->Error);
 }
 
-void TLuaEngine::TimedEvent::Reset() {
-    LastCompletion = std::chrono::high_resolution_clock::now();
+TEST_CASE("TLuaResult::WaitUntilReady") {
+    TLuaResult Result;
+    const auto Start = std::chrono::steady_clock::now();
+    CHECK(!Result.WaitUntilReady(Start + std::chrono::milliseconds(20)));
+    CHECK(std::chrono::steady_clock::now() - Start >= std::chrono::milliseconds(20));
+    std::thread Completer([&Result] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        Result.MarkAsReady();
+    });
+    CHECK(Result.WaitUntilReady(std::chrono::steady_clock::now() + std::chrono::seconds(10)));
+    Completer.join();
+    // already ready, returns right away
+    CHECK(Result.WaitUntilReady(std::chrono::steady_clock::time_point::min()));
+    Result.WaitUntilReady();
+}
+
+TLuaChunk::TLuaChunk(std::shared_ptr<std::string> Content, std::string FileName, std::string PluginPath)
+    : Content(Content)
+    , FileName(FileName)
+    , PluginPath(PluginPath) {
 }
@@ -0,0 +1,72 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "TMPSCQueue.h"
+
+#include "Common.h"
+#include <thread>
+#include <utility>
+#include <vector>
+
+TEST_CASE("TMPSCQueue") {
+    TMPSCQueue<std::pair<size_t, size_t>> Queue;
+    constexpr size_t Producers = 4;
+    constexpr size_t PerProducer = 50000;
+    std::vector<std::thread> Threads;
+    for (size_t p = 0; p < Producers; ++p) {
+        Threads.emplace_back([&Queue, p] {
+            for (size_t i = 0; i < PerProducer; ++i) {
+                Queue.Push({ p, i });
+            }
+        });
+    }
+    std::vector<size_t> Next(Producers, 0);
+    std::vector<std::pair<size_t, size_t>> Batch;
+    size_t Received = 0;
+    bool InOrder = true;
+    while (Received < Producers * PerProducer) {
+        REQUIRE(Queue.WaitForItems(std::chrono::seconds(5)));
+        Queue.PopBatch(Batch, 256);
+        CHECK(Batch.size() <= 256);
+        for (const auto& [Producer, i] : Batch) {
+            // each producer's items arrive in the order they were pushed
+            InOrder = InOrder && Next[Producer] == i;
+            Next[Producer] = i + 1;
+        }
+        Received += Batch.size();
+        Batch.clear();
+    }
+    for (auto& Thread : Threads) {
+        Thread.join();
+    }
+    CHECK(InOrder);
+    CHECK(Received == Producers * PerProducer);
+    CHECK(Queue.Size() == 0);
+    std::pair<size_t, size_t> Item;
+    CHECK(!Queue.TryPop(Item));
+    CHECK(!Queue.WaitForItems(std::chrono::milliseconds(1)));
+    // a consumer waiting without a timeout is woken by the next push
+    std::thread Waker([&Queue] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        Queue.Push({ 0, 0 });
+    });
+    Queue.WaitForItems();
+    CHECK(Queue.TryPop(Item));
+    Waker.join();
+}
@@ -39,20 +39,29 @@ std::vector<uint8_t> StringToVector(const std::string& Str) {
     return std::vector<uint8_t>(Str.data(), Str.data() + Str.size());
 }
 
-static void CompressProperly(std::vector<uint8_t>& Data) {
+std::span<const uint8_t> StringToSpan(const std::string& Str) {
+    return std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Str.data()), Str.size());
+}
+
+static std::vector<uint8_t> CompressedCopy(std::span<const uint8_t> Data) {
     constexpr std::string_view ABG = "ABG:";
     auto CombinedData = std::vector<uint8_t>(ABG.begin(), ABG.end());
     auto CompData = Comp(Data);
     CombinedData.resize(ABG.size() + CompData.size());
     std::copy(CompData.begin(), CompData.end(), CombinedData.begin() + ABG.size());
-    Data = CombinedData;
+    return CombinedData;
+}
+
+static void CompressProperly(std::vector<uint8_t>& Data) {
+    Data = CompressedCopy(Data);
 }
 
 TNetwork::TNetwork(TServer& Server, TPPSMonitor& PPSMonitor, TResourceManager& ResourceManager)
     : mServer(Server)
     , mPPSMonitor(PPSMonitor)
     , mUDPSock(Server.IoCtx())
-    , mResourceManager(ResourceManager) {
+    , mResourceManager(ResourceManager)
+    , mAuthCache([] { return std::chrono::seconds(Application::Settings.getAsInt(Settings::Key::Misc_AuthCacheSeconds)); }) {
     Application::SetSubsystemStatus("TCPNetwork", Application::Status::Starting);
     Application::SetSubsystemStatus("UDPNetwork", Application::Status::Starting);
     Application::RegisterShutdownHandler([&] {
@@ -151,6 +160,7 @@ void TNetwork::UDPServerMain() {
                     }
                     if (Client->GetUDPAddr() == remote_client_ep) {
                         Data.erase(Data.begin(), Data.begin() + 2);
+                        mServer.EventJournal().Record(TJournalKind::UdpReceived, ID, Data.empty() ? 0 : Data.front(), Data.size());
                         mServer.GlobalParser(ClientPtr, std::move(Data), mPPSMonitor, *this);
                     } else {
                         beammp_debugf("Ignored UDP packet due to remote address mismatch");
@@ -330,50 +340,71 @@ std::shared_ptr<TClient> TNetwork::Authentication(TConnection&& RawConnection) {
     std::string AuthKey = Application::Settings.getAsString(Settings::Key::General_AuthKey);
     std::string ClientIp = Client->GetIdentifiers().at("ip");
 
-    nlohmann::json AuthReq {};
-    std::string AuthResStr {};
-    try {
-        AuthReq = nlohmann::json {
-            { "key", Key },
-            { "auth_key", AuthKey },
-            { "client_ip", ClientIp }
-        };
-
-        auto Target = "/pkToUser";
-
-        unsigned int ResponseCode = 0;
-        AuthResStr = Http::POST(Application::GetBackendUrlForAuth(), 443, Target, AuthReq.dump(), "application/json", &ResponseCode);
+    std::optional<TAuthInfo> Auth = mAuthCache.Find(Key, ClientIp);
+    if (Auth) {
+        beammp_debugf("Using cached authentication for '{}'", Auth->Name);
+    } else {
+        nlohmann::json AuthReq {};
+        std::string AuthResStr {};
+        try {
+            AuthReq = nlohmann::json {
+                { "key", Key },
+                { "auth_key", AuthKey },
+                { "client_ip", ClientIp }
+            };
+
+            auto Target = "/pkToUser";
+
+            auto Slot = mJoinPipeline.Auth.Enter();
+            if (!Slot) {
+                // shutting down
+                return nullptr;
+            }
+            auto AuthRes = Http::POSTToOrigin("https://" + Application::GetBackendUrlForAuth() + ":443", Target, AuthReq.dump(), "application/json");
+            AuthResStr = AuthRes.Status == 0 ? Http::ErrorString : std::move(AuthRes.Body);
 
-    } catch (const std::exception& e) {
-        beammp_debugf("Invalid json sent by client, kicking: {}", e.what());
-        ClientKick(*Client, "Invalid Key (invalid UTF8 string)!");
-        return nullptr;
-    }
+        } catch (const std::exception& e) {
+            beammp_debugf("Invalid json sent by client, kicking: {}", e.what());
+            ClientKick(*Client, "Invalid Key (invalid UTF8 string)!");
+            return nullptr;
+        }
 
-    try {
-        nlohmann::json AuthRes = nlohmann::json::parse(AuthResStr);
-
-        if (AuthRes["username"].is_string() && AuthRes["roles"].is_string()
-            && AuthRes["guest"].is_boolean() && AuthRes["identifiers"].is_array()) {
-
-            Client->SetName(AuthRes["username"]);
-            Client->SetRoles(AuthRes["roles"]);
-            Client->SetIsGuest(AuthRes["guest"]);
-            for (const auto& ID : AuthRes["identifiers"]) {
-                auto Raw = std::string(ID);
-                auto SepIndex = Raw.find(':');
-                Client->SetIdentifier(Raw.substr(0, SepIndex), Raw.substr(SepIndex + 1));
+        try {
+            nlohmann::json AuthRes = nlohmann::json::parse(AuthResStr);
+
+            if (AuthRes["username"].is_string() && AuthRes["roles"].is_string()
+                && AuthRes["guest"].is_boolean() && AuthRes["identifiers"].is_array()) {
+
+                TAuthInfo Info {
+                    .Name = AuthRes["username"],
+                    .Roles = AuthRes["roles"],
+                    .IsGuest = AuthRes["guest"],
+                };
+                for (const auto& ID : AuthRes["identifiers"]) {
+                    auto Raw = std::string(ID);
+                    auto SepIndex = Raw.find(':');
+                    Info.Identifiers.emplace_back(Raw.substr(0, SepIndex), Raw.substr(SepIndex + 1));
+                }
+                mAuthCache.Insert(Key, ClientIp, Info);
+                Auth = std::move(Info);
+            } else {
+                beammp_error("Invalid authentication data received from authentication backend");
+                ClientKick(*Client, "Invalid authentication data!");
+                return nullptr;
             }
-        } else {
-            beammp_error("Invalid authentication data received from authentication backend");
-            ClientKick(*Client, "Invalid authentication data!");
+        } catch (const std::exception& e) {
+            beammp_errorf("Client sent invalid key. Error was: {}", e.what());
+            // TODO: we should really clarify that this was a backend response or parsing error
+            ClientKick(*Client, "Invalid key! Please restart your game.");
             return nullptr;
         }
-    } catch (const std::exception& e) {
-        beammp_errorf("Client sent invalid key. Error was: {}", e.what());
-        // TODO: we should really clarify that this was a backend response or parsing error
-        ClientKick(*Client, "Invalid key! Please restart your game.");
-        return nullptr;
+    }
+
+    Client->SetName(Auth->Name);
+    Client->SetRoles(Auth->Roles);
+    Client->SetIsGuest(Auth->IsGuest);
+    for (const auto& [Type, Value] : Auth->Identifiers) {
+        Client->SetIdentifier(Type, Value);
     }
 
     beammp_debug("Name -> " + Client->GetName() + ", Guest -> " + std::to_string(Client->IsGuest()) + ", Roles -> " + Client->GetRoles());
@@ -463,12 +494,12 @@ std::shared_ptr<TClient> TNetwork::CreateClient(ip::tcp::socket&& TCPSock) {
     return c;
 }
 
-bool TNetwork::TCPSend(TClient& c, const std::vector<uint8_t>& Data, bool IsSync) {
+bool TNetwork::TCPSend(TClient& c, std::span<const uint8_t> Data, bool IsSync) {
     if (!IsSync) {
         if (c.IsSyncing()) {
             if (!Data.empty()) {
-                if (Data.at(0) == 'O' || Data.at(0) == 'A' || Data.at(0) == 'C' || Data.at(0) == 'E') {
-                    c.EnqueuePacket(Data);
+                if (Data[0] == 'O' || Data[0] == 'A' || Data[0] == 'C' || Data[0] == 'E') {
+                    c.EnqueuePacket(std::vector<uint8_t>(Data.begin(), Data.end()));
                 }
             }
             return true;
@@ -486,12 +517,16 @@ bool TNetwork::TCPSend(TClient& c, const std::vector<uint8_t>& Data, bool IsSync
      */
 
     const auto Size = int32_t(Data.size());
-    std::vector<uint8_t> ToSend;
-    ToSend.resize(Data.size() + sizeof(Size));
-    std::memcpy(ToSend.data(), &Size, sizeof(Size));
-    std::memcpy(ToSend.data() + sizeof(Size), Data.data(), Data.size());
+    // gather-write header and payload, so large payloads (vehicle configs) aren't copied
+    const std::array<const_buffer, 2> ToSend {
+        buffer(&Size, sizeof(Size)),
+        buffer(Data.data(), Data.size()),
+    };
     boost::system::error_code ec;
-    write(Sock, buffer(ToSend), ec);
+    {
+        auto JournalScope = mServer.EventJournal().Measure(TJournalKind::TcpSent, c.GetID(), Data.empty() ? 0 : Data.front(), Data.size());
+        write(Sock, ToSend, ec);
+    }
     if (ec) {
         beammp_debugf("write(): {}", ec.message());
         c.Disconnect("write() failed");
@@ -635,6 +670,7 @@ void TNetwork::TCPClient(const std::weak_ptr<TClient>& c) {
             Client->Disconnect("TCPRcv failed");
             break;
         }
+        mServer.EventJournal().Record(TJournalKind::TcpReceived, Client->GetID(), res.front(), res.size());
         mServer.GlobalParser(c, std::move(res), mPPSMonitor, *this);
     }
 
@@ -723,7 +759,13 @@ void TNetwork::OnConnect(const std::weak_ptr<TClient>& c) {
     LockedClient->SetID(OpenID());
     beammp_info("Assigned ID " + std::to_string(LockedClient->GetID()) + " to " + LockedClient->GetName());
     LuaAPI::MP::Engine->ReportErrors(LuaAPI::MP::Engine->TriggerEvent("onPlayerConnecting", "", LockedClient->GetID()));
-    SyncResources(*LockedClient);
+    {
+        auto Slot = mJoinPipeline.ResourceSync.Enter();
+        if (!Slot) {
+            return;
+        }
+        SyncResources(*LockedClient);
+    }
     if (LockedClient->IsDisconnected())
         return;
     (void)Respond(*LockedClient, StringToVector("M" + Application::Settings.getAsString(Settings::Key::General_Map)), true); // Send the Map on connect
@@ -880,15 +922,19 @@ bool TNetwork::TCPSendRaw(TClient& C, ip::tcp::socket& socket, const uint8_t* Da
     return true;
 }
 
-bool TNetwork::SendLarge(TClient& c, std::vector<uint8_t> Data, bool isSync) {
+bool TNetwork::SendLarge(TClient& c, std::span<const uint8_t> Data, bool isSync) {
     if (Data.size() > 400) {
-        CompressProperly(Data);
+        return TCPSend(c, CompressedCopy(Data), isSync);
     }
     return TCPSend(c, Data, isSync);
 }
 
-bool TNetwork::Respond(TClient& c, const std::vector<uint8_t>& MSG, bool Rel, bool isSync) {
-    char C = MSG.at(0);
+bool TNetwork::Respond(TClient& c, std::span<const uint8_t> MSG, bool Rel, bool isSync) {
+    if (MSG.empty()) {
+        beammp_debug("tried to respond with an empty message, ignoring");
+        return false;
+    }
+    char C = char(MSG[0]);
     if (Rel || C == 'W' || C == 'Y' || C == 'V' || C == 'E' || compressBound(MSG.size()) > 1024) {
         if (C == 'O' || C == 'T' || MSG.size() > 1000) {
             return SendLarge(c, MSG, isSync);
@@ -896,7 +942,7 @@ bool TNetwork::Respond(TClient& c, const std::vector<uint8_t>& MSG, bool Rel, bo
             return TCPSend(c, MSG, isSync);
         }
     } else {
-        return UDPSend(c, MSG);
+        return UDPSend(c, std::vector<uint8_t>(MSG.begin(), MSG.end()));
     }
 }
 
@@ -916,9 +962,59 @@ bool TNetwork::SyncClient(const std::weak_ptr<TClient>& c) {
     (void)SendToAll(LockedClient.get(), StringToVector("JWelcome " + LockedClient->GetName() + "!"), false, true);
 
     LuaAPI::MP::Engine->ReportErrors(LuaAPI::MP::Engine->TriggerEvent("onPlayerJoin", "", LockedClient->GetID()));
+    auto Slot = mJoinPipeline.WorldSync.Enter();
+    if (!Slot) {
+        return false;
+    }
     LockedClient->SetIsSyncing(true);
-    bool Return = false;
-    bool res = true;
+    const bool Sent = !LockedClient->IsDisconnected() && SendWorldSnapshot(*LockedClient, *GetWorldSnapshot());
+    LockedClient->SetIsSyncing(false);
+    if (!Sent) {
+        return false;
+    }
+    LockedClient->SetIsSynced(true);
+    beammp_info(LockedClient->GetName() + (" is now synced!"));
+    return true;
+}
+
+bool TNetwork::SendWorldSnapshot(TClient& c, const TWorldSnapshot& Snapshot) {
+    if (Snapshot.Frames.empty()) {
+        return true;
+    }
+    const bool OwnsNone = std::none_of(Snapshot.Segments.begin(), Snapshot.Segments.end(),
+        [&](const TWorldSnapshot::TSegment& Segment) { return Segment.OwnerID == c.GetID(); });
+    bool Sent = true;
+    if (OwnsNone) {
+        // the common case: one write for the whole world
+        Sent = TCPSendRaw(c, c.GetTCPSock(), Snapshot.Frames.data(), Snapshot.Frames.size());
+    } else {
+        for (const auto& Segment : Snapshot.Segments) {
+            if (Segment.OwnerID != c.GetID()) {
+                Sent = TCPSendRaw(c, c.GetTCPSock(), Snapshot.Frames.data() + Segment.Offset, Segment.Size);
+                if (!Sent) {
+                    break;
+                }
+            }
+        }
+    }
+    if (!Sent) {
+        c.Disconnect("write() failed");
+    }
+    return Sent;
+}
+
+std::shared_ptr<const TWorldSnapshot> TNetwork::GetWorldSnapshot() {
+    // joiners wait for one another here, so that only the first one after a
+    // change pays for building the snapshot
+    std::unique_lock SnapshotLock(mWorldSnapshotMutex);
+    // read the version first: if anything changes while building, the
+    // snapshot is considered stale next time
+    const auto Version = mServer.VehicleStateVersion();
+    if (mWorldSnapshot && mWorldSnapshot->Version == Version) {
+        return mWorldSnapshot;
+    }
+    auto Snapshot = std::make_shared<TWorldSnapshot>();
+    Snapshot->Version = Version;
     mServer.ForEachClient([&](const std::weak_ptr<TClient>& ClientPtr) -> bool {
         std::shared_ptr<TClient> client;
         {
@@ -933,26 +1029,27 @@ bool TNetwork::SyncClient(const std::weak_ptr<TClient>& c) {
             auto LockedData = client->GetAllCars();
             VehicleData = *LockedData.VehicleData;
         } // End Vehicle Data Lock Scope
-        if (client != LockedClient) {
-            for (auto& v : VehicleData) {
-                if (LockedClient->IsDisconnected()) {
-                    Return = true;
-                    res = false;
-                    return false;
-                }
-                res = Respond(*LockedClient, StringToVector(v.Data()), true, true);
+        for (auto& v : VehicleData) {
+            const auto Data = v.Data();
+            // same encoding as Respond(..., true, true) uses for 'O' packets
+            std::vector<uint8_t> Compressed;
+            auto Payload = StringToSpan(*Data);
+            if (Payload.size() > 400) {
+                Compressed = CompressedCopy(Payload);
+                Payload = Compressed;
             }
+            const auto Size = int32_t(Payload.size());
+            const size_t Offset = Snapshot->Frames.size();
+            Snapshot->Frames.resize(Offset + sizeof(Size) + Payload.size());
+            std::memcpy(Snapshot->Frames.data() + Offset, &Size, sizeof(Size));
+            std::memcpy(Snapshot->Frames.data() + Offset + sizeof(Size), Payload.data(), Payload.size());
+            Snapshot->Segments.push_back({ client->GetID(), Offset, sizeof(Size) + Payload.size() });
         }
-
         return true;
     });
-    LockedClient->SetIsSyncing(false);
-    if (Return) {
-        return res;
-    }
-    LockedClient->SetIsSynced(true);
-    beammp_info(LockedClient->GetName() + (" is now synced!"));
-    return true;
+    beammp_debugf("Built world snapshot with {} vehicle(s), {} bytes", Snapshot->Segments.size(), Snapshot->Frames.size());
+    mWorldSnapshot = Snapshot;
+    return Snapshot;
 }
 
 void TNetwork::SendToAll(TClient* c, const std::vector<uint8_t>& Data, bool Self, bool Rel) {
@@ -1012,7 +1109,10 @@ bool TNetwork::UDPSend(TClient& Client, std::vector<uint8_t> Data) {
         CompressProperly(Data);
     }
     boost::system::error_code ec;
-    mUDPSock.send_to(buffer(Data), Addr, 0, ec);
+    {
+        auto JournalScope = mServer.EventJournal().Measure(TJournalKind::UdpSent, Client.GetID(), Data.empty() ? 0 : Data.front(), Data.size());
+        mUDPSock.send_to(buffer(Data), Addr, 0, ec);
+    }
     if (ec) {
         beammp_debugf("UDP sendto() failed: {}", ec.message());
         if (!Client.IsDisconnected())
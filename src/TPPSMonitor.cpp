@@ -45,7 +45,9 @@ void TPPSMonitor::operator()() {
     Application::SetSubsystemStatus("PPSMonitor", Application::Status::Good);
     std::vector<std::shared_ptr<TClient>> TimedOutClients;
     while (!Application::IsShuttingDown()) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (Application::SleepUntilShutdown(std::chrono::seconds(1))) {
+            break;
+        }
         int C = 0, V = 0;
         if (mServer.ClientCount() == 0) {
             Application::SetPPS("-");
@@ -136,4 +136,5 @@ void TResourceManager::RefreshFiles() {
             beammp_errorf("Sha256 hashing of '{}' failed: {}", File, e.what());
         }
     }
+    Application::NotifyPublicStateChanged();
 }
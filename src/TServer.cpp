@@ -29,8 +29,6 @@
 #include <optional>
 #include <sstream>
 
-#include <nlohmann/json.hpp>
-
 #include "LuaAPI.h"
 
 #undef GetObject // Fixes Windows
@@ -124,6 +122,11 @@ TEST_CASE("GetPidVid") {
 TServer::TServer(const std::vector<std::string_view>& Arguments) {
     beammp_info("BeamMP Server v" + Application::ServerVersionString());
     Application::SetSubsystemStatus("Server", Application::Status::Starting);
+    if (const int Records = Application::Settings.getAsInt(Settings::Key::Misc_EventJournalRecords); Records > 0) {
+        if (mEventJournal.Open("Server.journal", size_t(Records))) {
+            beammp_infof("Recording network events into 'Server.journal' (last {} events)", Records);
+        }
+    }
     Application::SetSubsystemStatus("Server", Application::Status::Good);
 }
 
@@ -139,8 +142,11 @@ void TServer::RemoveClient(const std::weak_ptr<TClient>& WeakClientPtr) {
     TClient& Client = *LockedClientPtr;
     beammp_debug("removing client " + Client.GetName() + " (" + std::to_string(ClientCount()) + ")");
     Client.ClearCars();
-    WriteLock Lock(mClientsMutex);
-    mClients.erase(WeakClientPtr.lock());
+    {
+        WriteLock Lock(mClientsMutex);
+        mClients.erase(WeakClientPtr.lock());
+    }
+    Application::NotifyPublicStateChanged();
 }
 
 void TServer::ForEachClient(const std::function<bool(std::weak_ptr<TClient>)>& Fn) {
@@ -190,6 +196,7 @@ void TServer::GlobalParser(const std::weak_ptr<TClient>& Client, std::vector<uin
 
     std::any Res;
     char Code = Packet.at(0);
+    auto JournalScope = mEventJournal.Measure(TJournalKind::Parsed, LockedClient->GetID(), uint8_t(Code), Packet.size());
 
     std::string StringPacket(reinterpret_cast<const char*>(Packet.data()), Packet.size());
 
@@ -282,21 +289,99 @@ void TServer::HandleEvent(TClient& c, const std::string& RawData) {
     LuaAPI::MP::Engine->ReportErrors(LuaAPI::MP::Engine->TriggerEvent(Name, "", c.GetID(), Data));
 }
 
-bool TServer::IsUnicycle(TClient& c, const std::string& CarJson) {
-    try {
-        auto Car = nlohmann::json::parse(CarJson);
-        const std::string jbm = "jbm";
-        if (Car.contains(jbm) && Car[jbm].is_string() && Car[jbm] == "unicycle") {
-            return true;
+enum class UnicycleProbe {
+    Unicycle,
+    Other,
+    Missing,
+    Malformed,
+};
+
+// SAX handler which only looks at the top-level "jbm" member, and stops the
+// parse as soon as its value is known.
+struct JbmProbeHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, JbmProbeHandler> {
+    int Depth { 0 };
+    bool NextIsJbm { false };
+    std::optional<bool> IsUnicycle;
+
+    bool Default() {
+        if (NextIsJbm) {
+            IsUnicycle = false;
+            return false;
+        }
+        return true;
+    }
+    bool String(const char* Str, rapidjson::SizeType Length, bool) {
+        if (NextIsJbm) {
+            IsUnicycle = std::string_view(Str, Length) == "unicycle";
+            return false;
         }
-    } catch (const std::exception& e) {
-        beammp_warn("Failed to parse vehicle data as json for client " + std::to_string(c.GetID()) + ": '" + CarJson + "'.");
+        return true;
+    }
+    bool Key(const char* Str, rapidjson::SizeType Length, bool) {
+        NextIsJbm = Depth == 1 && std::string_view(Str, Length) == "jbm";
+        return true;
+    }
+    bool StartObject() {
+        if (!Default()) {
+            return false;
+        }
+        ++Depth;
+        return true;
+    }
+    bool EndObject(rapidjson::SizeType) {
+        --Depth;
+        return true;
+    }
+    bool StartArray() { return StartObject(); }
+    bool EndArray(rapidjson::SizeType Count) { return EndObject(Count); }
+};
+
+static UnicycleProbe ProbeUnicycle(std::string_view CarJson) {
+    JbmProbeHandler Handler;
+    rapidjson::MemoryStream Stream(CarJson.data(), CarJson.size());
+    rapidjson::Reader Reader;
+    const rapidjson::ParseResult Result = Reader.Parse(Stream, Handler);
+    if (Handler.IsUnicycle.has_value()) {
+        // anything after "jbm" is not looked at, so malformed json is only detected up to there
+        return Handler.IsUnicycle.value() ? UnicycleProbe::Unicycle : UnicycleProbe::Other;
+    }
+    return Result.IsError() ? UnicycleProbe::Malformed : UnicycleProbe::Missing;
+}
+
+TEST_CASE("ProbeUnicycle") {
+    SUBCASE("Top-level jbm") {
+        CHECK_EQ(ProbeUnicycle(R"({"jbm":"unicycle"})"), UnicycleProbe::Unicycle);
+        CHECK_EQ(ProbeUnicycle(R"({"vcf":{"parts":{"a":"b"}},"jbm":"unicycle","pnt":[1,2]})"), UnicycleProbe::Unicycle);
+        CHECK_EQ(ProbeUnicycle(R"({"jbm":"pickup"})"), UnicycleProbe::Other);
+        CHECK_EQ(ProbeUnicycle(R"({"jbm":1})"), UnicycleProbe::Other);
+        CHECK_EQ(ProbeUnicycle(R"({"jbm":null})"), UnicycleProbe::Other);
+    }
+    SUBCASE("Nested jbm is ignored") {
+        CHECK_EQ(ProbeUnicycle(R"({"vcf":{"jbm":"unicycle"}})"), UnicycleProbe::Missing);
+        CHECK_EQ(ProbeUnicycle(R"({"a":[{"jbm":"unicycle"}],"jbm":"pickup"})"), UnicycleProbe::Other);
+        CHECK_EQ(ProbeUnicycle(R"({"jbm":{"jbm":"unicycle"}})"), UnicycleProbe::Other);
+        CHECK_EQ(ProbeUnicycle(R"([{"jbm":"unicycle"}])"), UnicycleProbe::Missing);
+        CHECK_EQ(ProbeUnicycle(R"({"vcf":{"x":"jbm"},"y":"unicycle"})"), UnicycleProbe::Missing);
+    }
+    SUBCASE("Malformed json") {
+        CHECK_EQ(ProbeUnicycle(""), UnicycleProbe::Malformed);
+        CHECK_EQ(ProbeUnicycle("not json"), UnicycleProbe::Malformed);
+        CHECK_EQ(ProbeUnicycle(R"({"vcf":{,"jbm":"unicycle"})"), UnicycleProbe::Malformed);
+        CHECK_EQ(ProbeUnicycle(R"({"vcf":{"a":"b"})"), UnicycleProbe::Malformed);
+        CHECK_EQ(ProbeUnicycle(R"({"jbm":"unicycle")"), UnicycleProbe::Unicycle);
+    }
+}
+
+bool TServer::IsUnicycle(TClient& c, std::string_view CarJson) {
+    const auto Probe = ProbeUnicycle(CarJson);
+    if (Probe == UnicycleProbe::Malformed) {
+        beammp_warn("Failed to parse vehicle data as json for client " + std::to_string(c.GetID()) + ": '" + std::string(CarJson) + "'.");
     }
-    return false;
+    return Probe == UnicycleProbe::Unicycle;
 }
 
-bool TServer::ShouldSpawn(TClient& c, const std::string& CarJson, int ID) {
-    if (IsUnicycle(c, CarJson) && c.GetUnicycleID() < 0) {
+bool TServer::ShouldSpawn(TClient& c, bool IsUnicycle, int ID) {
+    if (IsUnicycle && c.GetUnicycleID() < 0) {
         c.SetUnicycleID(ID);
         return true;
     } else {
@@ -329,8 +414,9 @@ void TServer::ParseVehicle(TClient& c, const std::string& Pckt, TNetwork& Networ
                 });
 
             bool SpawnConfirmed = false;
-            if (ShouldSpawn(c, CarJson, CarID) && !ShouldntSpawn) {
-                c.AddNewCar(CarID, Packet);
+            const bool Unicycle = IsUnicycle(c, CarJson);
+            if (ShouldSpawn(c, Unicycle, CarID) && !ShouldntSpawn) {
+                c.AddNewCar(CarID, Packet, Unicycle);
                 Network.SendToAll(nullptr, StringToVector(Packet), true, true);
                 SpawnConfirmed = true;
             } else {
@@ -366,8 +452,17 @@ void TServer::ParseVehicle(TClient& c, const std::string& Pckt, TNetwork& Networ
 
             auto FoundPos = Packet.find('{');
             FoundPos = FoundPos == std::string::npos ? 0 : FoundPos; // attempt at sanitizing this
+            bool StillUnicycle = false;
+            if (c.GetUnicycleID() == VID) {
+                // edits which don't touch "jbm" keep whatever was determined before
+                const auto Probe = ProbeUnicycle(std::string_view(Packet).substr(FoundPos));
+                if (Probe == UnicycleProbe::Malformed) {
+                    beammp_warn("Failed to parse vehicle data as json for client " + std::to_string(c.GetID()) + ": '" + Packet.substr(FoundPos) + "'.");
+                }
+                StillUnicycle = Probe == UnicycleProbe::Unicycle || (Probe == UnicycleProbe::Missing && c.IsCarUnicycle(VID));
+            }
             bool Allowed = false;
-            if ((c.GetUnicycleID() != VID || IsUnicycle(c, Packet.substr(FoundPos)))
+            if ((c.GetUnicycleID() != VID || StillUnicycle)
                 && !ShouldntAllow) {
                 Network.SendToAll(&c, StringToVector(Packet), false, true);
                 Apply(c, VID, Packet);
@@ -448,48 +543,27 @@ void TServer::Apply(TClient& c, int VID, const std::string& pckt) {
         beammp_error("Malformed packet received, no '{' found");
         return;
     }
-    std::string Packet = pckt.substr(FoundPos);
-    std::string VD = c.GetCarData(VID);
-    if (VD.empty()) {
+    // the vehicle keeps its parsed config around, so this only parses the edit
+    switch (c.ApplyCarEdit(VID, std::string_view(pckt).substr(FoundPos))) {
+    case TClient::EditResult::Applied:
+        break;
+    case TClient::EditResult::NoSuchVehicle:
         beammp_error("Tried to apply change to vehicle that does not exist");
-        return;
+        break;
+    case TClient::EditResult::Invalid:
+        // ApplyEdit already said what was wrong with it
+        beammp_debugf("Ignored invalid edit of vehicle {} of client {}", VID, c.GetID());
+        break;
     }
-    std::string Header = VD.substr(0, VD.find('{'));
-
-    FoundPos = VD.find('{');
-    if (FoundPos == std::string::npos) {
-        return;
-    }
-    VD = VD.substr(FoundPos);
-    rapidjson::Document Veh, Pack;
-    Veh.Parse(VD.c_str());
-    if (Veh.HasParseError()) {
-        beammp_error("Could not get vehicle config!");
-        return;
-    }
-    Pack.Parse(Packet.c_str());
-    if (Pack.HasParseError() || Pack.IsNull()) {
-        beammp_error("Could not get active vehicle config!");
-        return;
-    }
-
-    for (auto& M : Pack.GetObject()) {
-        if (Veh[M.name].IsNull()) {
-            Veh.AddMember(M.name, M.value, Veh.GetAllocator());
-        } else {
-            Veh[M.name] = Pack[M.name];
-        }
-    }
-    rapidjson::StringBuffer Buffer;
-    rapidjson::Writer<rapidjson::StringBuffer> writer(Buffer);
-    Veh.Accept(writer);
-    c.SetCarData(VID, Header + Buffer.GetString());
 }
 
 void TServer::InsertClient(const std::shared_ptr<TClient>& NewClient) {
     beammp_debug("inserting client (" + std::to_string(ClientCount()) + ")");
-    WriteLock Lock(mClientsMutex); // TODO why is there 30+ threads locked here
-    (void)mClients.insert(NewClient);
+    {
+        WriteLock Lock(mClientsMutex); // TODO why is there 30+ threads locked here
+        (void)mClients.insert(NewClient);
+    }
+    Application::NotifyPublicStateChanged();
 }
 
 struct PidVidData {
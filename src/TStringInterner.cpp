@@ -0,0 +1,122 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "TStringInterner.h"
+
+#include "Common.h"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TStringInterner& TStringInterner::Global() {
+    // leaked, so that states which are still running during static destruction can use it
+    static auto* Interner = new TStringInterner;
+    return *Interner;
+}
+
+TStringInterner::~TStringInterner() {
+    for (auto& Chunk : mChunks) {
+        delete[] Chunk.load(std::memory_order_relaxed);
+    }
+}
+
+TStringId TStringInterner::Intern(std::string_view Str) {
+    if (auto Id = Find(Str)) {
+        return Id.value();
+    }
+    WriteLock Lock(mMutex);
+    // someone else may have added it in the meantime
+    if (auto Iter = mIds.find(Str); Iter != mIds.end()) {
+        return Iter->second;
+    }
+    const size_t Index = mSize.load(std::memory_order_relaxed);
+    if (Index / ChunkSize >= MaxChunks) {
+        throw std::length_error("too many interned strings");
+    }
+    auto& Chunk = mChunks[Index / ChunkSize];
+    if (!Chunk.load(std::memory_order_relaxed)) {
+        Chunk.store(new std::string[ChunkSize], std::memory_order_release);
+    }
+    auto& Stored = Chunk.load(std::memory_order_relaxed)[Index % ChunkSize];
+    Stored = Str;
+    const auto Id = TStringId(Index);
+    mIds.emplace(Stored, Id);
+    mSize.store(Index + 1, std::memory_order_release);
+    return Id;
+}
+
+std::optional<TStringId> TStringInterner::Find(std::string_view Str) {
+    ReadLock Lock(mMutex);
+    if (auto Iter = mIds.find(Str); Iter != mIds.end()) {
+        return Iter->second;
+    }
+    return std::nullopt;
+}
+
+const std::string& TStringInterner::Get(TStringId Id) const {
+    return mChunks[Id / ChunkSize].load(std::memory_order_acquire)[Id % ChunkSize];
+}
+
+TEST_CASE("TStringInterner") {
+    TStringInterner Interner;
+    auto Empty = Interner.Intern("");
+    auto A = Interner.Intern("onPlayerJoin");
+    auto B = Interner.Intern(std::string("onPlayerLeave"));
+    CHECK(A != B);
+    CHECK(Empty != A);
+    CHECK(Interner.Intern(std::string("onPlayer") + "Join") == A);
+    CHECK(Interner.Get(A) == "onPlayerJoin");
+    CHECK(Interner.Get(B) == "onPlayerLeave");
+    CHECK(Interner.Get(Empty).empty());
+    CHECK(Interner.Find("onPlayerLeave") == B);
+    // finding doesn't intern
+    CHECK(!Interner.Find("onNothing").has_value());
+    CHECK(Interner.Size() == 3);
+
+    SUBCASE("Concurrent interning agrees on ids") {
+        // enough strings to span several chunks
+        constexpr size_t Count = 4999;
+        constexpr size_t Threads = 4;
+        std::vector<std::vector<TStringId>> Ids(Threads, std::vector<TStringId>(Count));
+        std::vector<std::thread> Workers;
+        for (size_t t = 0; t < Threads; ++t) {
+            Workers.emplace_back([&, t] {
+                // every thread goes through the strings in a different order, Count is prime
+                for (size_t i = 0; i < Count; ++i) {
+                    const size_t n = (i * (t * 2 + 1)) % Count;
+                    Ids[t][n] = Interner.Intern("event" + std::to_string(n));
+                }
+            });
+        }
+        for (auto& Worker : Workers) {
+            Worker.join();
+        }
+        bool Agree = true;
+        bool RoundTrips = true;
+        for (size_t n = 0; n < Count; ++n) {
+            for (size_t t = 1; t < Threads; ++t) {
+                Agree = Agree && Ids[t][n] == Ids[0][n];
+            }
+            RoundTrips = RoundTrips && Interner.Get(Ids[0][n]) == "event" + std::to_string(n);
+        }
+        CHECK(Agree);
+        CHECK(RoundTrips);
+        CHECK(Interner.Size() == Count + 3);
+        CHECK(Interner.Get(A) == "onPlayerJoin");
+    }
+}
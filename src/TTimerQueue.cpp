@@ -0,0 +1,103 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+#include "TTimerQueue.h"
+
+#include "Common.h"
+#include <chrono>
+#include <vector>
+
+TEST_CASE("TTimerQueue") {
+    using namespace std::chrono_literals;
+    using Queue = TTimerQueue<int>;
+    const auto Start = Queue::Clock::now();
+    Queue Timers;
+    CHECK(!Timers.NextDue().has_value());
+    Timers.Add(1, 110ms, Start);
+    Timers.Add(2, 30ms, Start);
+    Timers.Add(3, 50ms, Start);
+    REQUIRE(Timers.NextDue().has_value());
+    CHECK(Timers.NextDue().value() == Start + 30ms);
+
+    std::vector<int> Fired;
+    auto Record = [&](int Data) {
+        Fired.push_back(Data);
+        return true;
+    };
+    Timers.FireDue(Start + 29ms, Record);
+    CHECK(Fired.empty());
+    Timers.FireDue(Start + 30ms, Record);
+    Timers.FireDue(Start + 55ms, Record);
+    CHECK(Fired == std::vector<int>({ 2, 3 }));
+    // 2 is due at 60 and 90ms, the one at 90ms was missed and is skipped, not fired in a burst
+    Fired.clear();
+    Timers.FireDue(Start + 100ms, Record);
+    CHECK(Fired == std::vector<int>({ 2, 3 }));
+    // fires in order of when they were due, and stays on the original schedule
+    Fired.clear();
+    Timers.FireDue(Start + 125ms, Record);
+    CHECK(Fired == std::vector<int>({ 1, 2 }));
+    CHECK(Timers.NextDue().value() == Start + 150ms);
+
+    // a tick which Fire() declines counts as skipped
+    Timers.FireDue(Start + 150ms, [](int) { return false; });
+    Timers.ForEach([&](const Queue::TTimer& Timer) {
+        if (Timer.Data == 2) {
+            // fired 0, 40 and 5ms late
+            CHECK(Timer.Stats.Fired == 3);
+            CHECK(Timer.Stats.Skipped == 2);
+            CHECK(Timer.Stats.MaxDrift == 40ms);
+            CHECK(Timer.Stats.AverageDrift() == 15ms);
+            CHECK(Timer.NextDue == Start + 180ms);
+        }
+    });
+
+    CHECK(Timers.RemoveIf([](int Data) { return Data == 2; }) == 1);
+    CHECK(Timers.Size() == 2);
+    Fired.clear();
+    Timers.FireDue(Start + 250ms, Record);
+    CHECK(Fired == std::vector<int>({ 3, 1 }));
+    CHECK(Timers.RemoveIf([](int) { return true; }) == 2);
+    CHECK(!Timers.NextDue().has_value());
+
+    SUBCASE("Many timers") {
+        constexpr int Count = 10000;
+        for (int i = 0; i < Count; ++i) {
+            Timers.Add(i, std::chrono::milliseconds(1 + i % 100), Start);
+        }
+        // removing most of them leaves stale heap entries behind, which mustn't fire
+        CHECK(Timers.RemoveIf([](int Data) { return Data % 10 != 0; }) == size_t(Count - Count / 10));
+        size_t Calls = 0;
+        bool AllKept = true;
+        for (auto Now = Start; Now <= Start + 1000ms; Now += 1ms) {
+            Timers.FireDue(Now, [&](int Data) {
+                AllKept = AllKept && Data % 10 == 0;
+                ++Calls;
+                return true;
+            });
+        }
+        CHECK(AllKept);
+        size_t Expected = 0;
+        for (int i = 0; i < Count; i += 10) {
+            Expected += 1000 / (1 + i % 100);
+        }
+        CHECK(Calls == Expected);
+        CHECK(Timers.Size() == size_t(Count / 10));
+    }
+}
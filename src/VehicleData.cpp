@@ -19,14 +19,361 @@
 #include "VehicleData.h"
 
 #include "Common.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 #include <utility>
 
-TVehicleData::TVehicleData(int ID, std::string Data)
+#undef GetObject // Fixes Windows
+
+#include "Json.h"
+
+struct TVehicleData::TEditState {
+    // everything in front of the json, e.g. "Os:role:name:pid-vid:"
+    std::string Header;
+    rapidjson::Document Config;
+    bool Dirty { false };
+};
+
+struct TVehicleData::TCompactConfig {
+    std::vector<uint8_t> Compressed;
+    size_t RawSize { 0 };
+};
+
+namespace {
+// Compact configs by hash of their compressed bytes, so that identical configs
+// spawned by different players are only stored once. Compression is
+// deterministic, so equal compressed bytes mean equal configs.
+struct CompactConfigPool {
+    std::mutex Mutex;
+    std::unordered_multimap<size_t, std::weak_ptr<const TVehicleData::TCompactConfig>> Configs;
+    size_t SizeAfterLastSweep { 0 };
+};
+
+CompactConfigPool& Pool() {
+    static CompactConfigPool Instance;
+    return Instance;
+}
+}
+
+static std::shared_ptr<const TVehicleData::TCompactConfig> InternCompactConfig(std::string_view Json) {
+    auto Compressed = Comp(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Json.data()), Json.size()));
+    const auto Hash = std::hash<std::string_view> {}(std::string_view(reinterpret_cast<const char*>(Compressed.data()), Compressed.size()));
+    auto& P = Pool();
+    std::unique_lock Lock(P.Mutex);
+    auto [Begin, End] = P.Configs.equal_range(Hash);
+    for (auto Iter = Begin; Iter != End;) {
+        if (auto Existing = Iter->second.lock()) {
+            if (Existing->Compressed == Compressed) {
+                return Existing;
+            }
+            ++Iter;
+        } else {
+            Iter = P.Configs.erase(Iter);
+        }
+    }
+    auto Config = std::make_shared<TVehicleData::TCompactConfig>();
+    Config->Compressed = std::move(Compressed);
+    Config->RawSize = Json.size();
+    P.Configs.emplace(Hash, Config);
+    // configs of deleted vehicles only get dropped from their own bucket above,
+    // so every now and then get rid of all of them
+    if (P.Configs.size() > 2 * P.SizeAfterLastSweep + 64) {
+        std::erase_if(P.Configs, [](const auto& Pair) { return Pair.second.expired(); });
+        P.SizeAfterLastSweep = P.Configs.size();
+    }
+    return Config;
+}
+
+size_t TVehicleData::CompactConfigCount() {
+    auto& P = Pool();
+    std::unique_lock Lock(P.Mutex);
+    return size_t(std::count_if(P.Configs.begin(), P.Configs.end(), [](const auto& Pair) { return !Pair.second.expired(); }));
+}
+
+TVehicleData::TVehicleData(int ID, std::string Data, bool IsUnicycle)
     : mID(ID)
-    , mData(std::move(Data)) {
+    , mIsUnicycle(IsUnicycle) {
+    Store(std::move(Data));
     beammp_trace("vehicle " + std::to_string(mID) + " constructed");
 }
 
+TVehicleData::TVehicleData(const TVehicleData& Other)
+    : mID(Other.mID)
+    , mIsUnicycle(Other.mIsUnicycle) {
+    *this = Other;
+}
+
+TVehicleData::TVehicleData(TVehicleData&& Other) noexcept = default;
+
+TVehicleData& TVehicleData::operator=(const TVehicleData& Other) {
+    if (this != &Other) {
+        if (Other.mEdits && Other.mEdits->Dirty) {
+            Other.FlushEdits();
+        }
+        mID = Other.mID;
+        mIsUnicycle = Other.mIsUnicycle;
+        mData = Other.mData;
+        mHeader = Other.mHeader;
+        mCompact = Other.mCompact;
+        mEdits.reset();
+    }
+    return *this;
+}
+
+TVehicleData& TVehicleData::operator=(TVehicleData&& Other) noexcept = default;
+
 TVehicleData::~TVehicleData() {
     beammp_trace("vehicle " + std::to_string(mID) + " destroyed");
 }
+
+std::shared_ptr<const std::string> TVehicleData::Data() const {
+    if (mEdits && mEdits->Dirty) {
+        FlushEdits();
+    }
+    if (mCompact) {
+        const auto Json = DeComp(mCompact->Compressed);
+        std::string Result;
+        Result.reserve(mHeader.size() + Json.size());
+        Result.append(mHeader);
+        Result.append(reinterpret_cast<const char*>(Json.data()), Json.size());
+        return std::make_shared<const std::string>(std::move(Result));
+    }
+    return mData;
+}
+
+void TVehicleData::SetData(std::string Data) {
+    Store(std::move(Data));
+    mEdits.reset();
+}
+
+void TVehicleData::Store(std::string Data) const {
+    const auto FoundPos = Data.find('{');
+    if (FoundPos != std::string::npos && Application::Settings.getAsBool(Settings::Key::Misc_CompactVehicleConfigs)) {
+        mCompact = InternCompactConfig(std::string_view(Data).substr(FoundPos));
+        mHeader = Data.substr(0, FoundPos);
+        mData.reset();
+    } else {
+        mData = std::make_shared<const std::string>(std::move(Data));
+        mHeader.clear();
+        mCompact.reset();
+    }
+}
+
+size_t TVehicleData::StoredSize() const {
+    if (mCompact) {
+        return mHeader.size() + mCompact->RawSize;
+    }
+    return mData ? mData->size() : 0;
+}
+
+size_t TVehicleData::MemoryUsage() const {
+    size_t Usage = 0;
+    if (mCompact) {
+        Usage += mHeader.size() + mCompact->Compressed.size() / size_t(std::max(mCompact.use_count(), 1L));
+    } else if (mData) {
+        Usage += mData->size();
+    }
+    if (mEdits) {
+        Usage += mEdits->Header.size() + mEdits->Config.GetAllocator().Size();
+    }
+    return Usage;
+}
+
+void TVehicleData::FlushEdits() const {
+    rapidjson::StringBuffer Buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> Writer(Buffer);
+    mEdits->Config.Accept(Writer);
+    std::string Serialized;
+    Serialized.reserve(mEdits->Header.size() + Buffer.GetSize());
+    Serialized.append(mEdits->Header);
+    Serialized.append(Buffer.GetString(), Buffer.GetSize());
+    Store(std::move(Serialized));
+    mEdits->Dirty = false;
+}
+
+bool TVehicleData::ApplyEdit(std::string_view Patch) {
+    rapidjson::Document Pack;
+    Pack.Parse(Patch.data(), Patch.size());
+    if (Pack.HasParseError() || !Pack.IsObject()) {
+        beammp_error("Could not get active vehicle config!");
+        return false;
+    }
+    if (!mEdits) {
+        const auto Current = Data();
+        const auto FoundPos = Current ? Current->find('{') : std::string::npos;
+        if (FoundPos == std::string::npos) {
+            beammp_error("Could not get vehicle config!");
+            return false;
+        }
+        auto State = std::make_unique<TEditState>();
+        State->Header = Current->substr(0, FoundPos);
+        State->Config.Parse(Current->data() + FoundPos, Current->size() - FoundPos);
+        if (State->Config.HasParseError() || !State->Config.IsObject()) {
+            beammp_error("Could not get vehicle config!");
+            return false;
+        }
+        mEdits = std::move(State);
+    }
+    auto& Config = mEdits->Config;
+    auto& Allocator = Config.GetAllocator();
+    for (auto& Member : Pack.GetObject()) {
+        auto Existing = Config.FindMember(Member.name);
+        if (Existing == Config.MemberEnd()) {
+            rapidjson::Value Name(Member.name, Allocator);
+            rapidjson::Value Value(Member.value, Allocator);
+            Config.AddMember(Name, Value, Allocator);
+        } else {
+            Existing->value.CopyFrom(Member.value, Allocator);
+        }
+    }
+    mEdits->Dirty = true;
+    if (auto Jbm = Pack.FindMember("jbm"); Jbm != Pack.MemberEnd()) {
+        mIsUnicycle = Jbm->value.IsString() && std::string_view(Jbm->value.GetString(), Jbm->value.GetStringLength()) == "unicycle";
+    }
+    // replaced values stay in the document's memory pool until it's destroyed,
+    // so once the pool has grown well past the config itself, start over.
+    // compactly stored configs trade cpu time for memory, so they don't keep
+    // the document around at all.
+    if (mCompact || Allocator.Size() > 4 * StoredSize() + 64 * 1024) {
+        FlushEdits();
+        mEdits.reset();
+    }
+    return true;
+}
+
+TEST_CASE("TVehicleData::ApplyEdit") {
+    TVehicleData Vehicle(0, R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":1})");
+    SUBCASE("Replaces existing members") {
+        CHECK(Vehicle.ApplyEdit(R"({"vcf":{"parts":{"a":"c"}}})"));
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"c"}},"pnt":1})");
+    }
+    SUBCASE("Adds new members") {
+        CHECK(Vehicle.ApplyEdit(R"({"col":[1,2,3]})"));
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":1,"col":[1,2,3]})");
+    }
+    SUBCASE("Multiple edits before a read") {
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":2})"));
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":3,"col":"red"})"));
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":3,"col":"red"})");
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":4})"));
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":4,"col":"red"})");
+    }
+    SUBCASE("Copies are flushed snapshots") {
+        const auto Before = Vehicle.Data();
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":2})"));
+        TVehicleData Copy = Vehicle;
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":3})"));
+        CHECK_EQ(*Before, R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":1})");
+        CHECK_EQ(*Copy.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":2})");
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":3})");
+    }
+    SUBCASE("Invalid patches are rejected") {
+        CHECK(!Vehicle.ApplyEdit(R"({"pnt":)"));
+        CHECK(!Vehicle.ApplyEdit(R"([1,2])"));
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"pickup","vcf":{"parts":{"a":"b"}},"pnt":1})");
+    }
+    SUBCASE("Edits of jbm update the unicycle flag") {
+        CHECK(!Vehicle.IsUnicycle());
+        CHECK(Vehicle.ApplyEdit(R"({"jbm":"unicycle"})"));
+        CHECK(Vehicle.IsUnicycle());
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":2})"));
+        CHECK(Vehicle.IsUnicycle());
+        CHECK(Vehicle.ApplyEdit(R"({"jbm":"pickup"})"));
+        CHECK(!Vehicle.IsUnicycle());
+    }
+    SUBCASE("SetData drops pending edits") {
+        CHECK(Vehicle.ApplyEdit(R"({"pnt":2})"));
+        Vehicle.SetData(R"(Os:USER:foo:0-0:{"jbm":"unicycle"})");
+        CHECK_EQ(*Vehicle.Data(), R"(Os:USER:foo:0-0:{"jbm":"unicycle"})");
+    }
+}
+
+TEST_CASE("TVehicleData compact storage") {
+    const bool WasCompact = Application::Settings.getAsBool(Settings::Key::Misc_CompactVehicleConfigs);
+    Application::Settings.set(Settings::Key::Misc_CompactVehicleConfigs, true);
+    const std::string Json = R"({"jbm":"pickup","vcf":{"parts":{"a":"b","c":"d","e":"f"}},"pnt":1})";
+    const auto CountBefore = TVehicleData::CompactConfigCount();
+    {
+        TVehicleData A(0, "Os:USER:foo:0-0:" + Json);
+        TVehicleData B(0, "Os:USER:bar:1-0:" + Json);
+        CHECK_EQ(*A.Data(), "Os:USER:foo:0-0:" + Json);
+        CHECK_EQ(*B.Data(), "Os:USER:bar:1-0:" + Json);
+        // identical configs are only stored once
+        CHECK_EQ(TVehicleData::CompactConfigCount(), CountBefore + 1);
+        CHECK(A.MemoryUsage() < Json.size());
+
+        CHECK(B.ApplyEdit(R"({"pnt":2})"));
+        CHECK_EQ(*A.Data(), "Os:USER:foo:0-0:" + Json);
+        CHECK_EQ(*B.Data(), R"(Os:USER:bar:1-0:{"jbm":"pickup","vcf":{"parts":{"a":"b","c":"d","e":"f"}},"pnt":2})");
+        CHECK_EQ(TVehicleData::CompactConfigCount(), CountBefore + 2);
+
+        TVehicleData Copy = B;
+        CHECK_EQ(*Copy.Data(), *B.Data());
+        CHECK_EQ(TVehicleData::CompactConfigCount(), CountBefore + 2);
+    }
+    CHECK_EQ(TVehicleData::CompactConfigCount(), CountBefore);
+    Application::Settings.set(Settings::Key::Misc_CompactVehicleConfigs, WasCompact);
+}
+
+TEST_CASE("TVehicleData::ApplyEdit matches a full re-parse") {
+    // a config roughly the size of a modded car's, ~30 KB
+    const auto MakeVcf = [](int Variant) {
+        std::string Vcf = R"({"parts":{)";
+        for (int i = 0; i < 400; ++i) {
+            Vcf += fmt::format(R"("pickup_slot_{}":"pickup_part_{}_v{}",)", i, i, Variant);
+        }
+        Vcf.back() = '}';
+        Vcf += R"(,"vars":{)";
+        for (int i = 0; i < 250; ++i) {
+            Vcf += fmt::format(R"("$tuning_var_{}":{}.{},)", i, i, Variant);
+        }
+        Vcf.back() = '}';
+        Vcf += R"(,"partConfigFilename":"vehicles/pickup/custom.pc"})";
+        return Vcf;
+    };
+    const std::string Header = "Os:USER:foo:0-0:";
+    const std::string Initial = Header + R"({"jbm":"pickup","vcf":)" + MakeVcf(0) + R"(,"col":[0.1,0.2,0.3,1],"pnt":"[]"})";
+    CHECK(Initial.size() > 25 * 1024);
+    std::vector<std::string> Patches;
+    for (int i = 1; i <= 8; ++i) {
+        Patches.push_back(R"({"vcf":)" + MakeVcf(i) + "}");
+        Patches.push_back(fmt::format(R"({{"col":[0.{},0.2,0.3,1]}})", i));
+    }
+    // what TServer::Apply used to do for every edit: parse both, merge, serialize
+    const auto ApplyByReparse = [](const std::string& Stored, const std::string& Patch) {
+        const auto FoundPos = Stored.find('{');
+        rapidjson::Document Veh, Pack;
+        Veh.Parse(Stored.c_str() + FoundPos);
+        Pack.Parse(Patch.c_str());
+        for (auto& M : Pack.GetObject()) {
+            if (Veh[M.name].IsNull()) {
+                Veh.AddMember(M.name, M.value, Veh.GetAllocator());
+            } else {
+                Veh[M.name] = Pack[M.name];
+            }
+        }
+        rapidjson::StringBuffer Buffer;
+        rapidjson::Writer<rapidjson::StringBuffer> Writer(Buffer);
+        Veh.Accept(Writer);
+        return Stored.substr(0, FoundPos) + Buffer.GetString();
+    };
+    constexpr int Rounds = 2;
+
+    std::string Reparsed = Initial;
+    for (int Round = 0; Round < Rounds; ++Round) {
+        for (const auto& Patch : Patches) {
+            Reparsed = ApplyByReparse(Reparsed, Patch);
+        }
+    }
+
+    TVehicleData Vehicle(0, Initial);
+    bool AllApplied = true;
+    for (int Round = 0; Round < Rounds; ++Round) {
+        for (const auto& Patch : Patches) {
+            AllApplied = Vehicle.ApplyEdit(Patch) && AllApplied;
+        }
+    }
+    CHECK(AllApplied);
+    CHECK_EQ(*Vehicle.Data(), Reparsed);
+}
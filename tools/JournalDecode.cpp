@@ -0,0 +1,94 @@
+// BeamMP, the BeamNG.drive multiplayer mod.
+// Copyright (C) 2024 BeamMP Ltd., BeamMP team and contributors.
+//
+// BeamMP Ltd. can be contacted by electronic mail via contact@beammp.com.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+// Prints a binary event journal (see TEventJournal.h) as CSV, or a summary
+// per event kind and packet code.
+//
+// Usage: BeamMP-Server-journal <Server.journal> [--summary]
+
+#include "TEventJournal.h"
+
+#include <cstdio>
+#include <map>
+#include <string_view>
+#include <tuple>
+
+static void PrintCsv(const std::vector<TJournalRecord>& Records) {
+    std::printf("sequence,timestamp_ns,player_id,kind,code,size,latency_us\n");
+    for (const auto& Record : Records) {
+        std::printf("%llu,%llu,%d,%s,%c,%u,%u\n",
+            static_cast<unsigned long long>(Record.Sequence),
+            static_cast<unsigned long long>(Record.TimestampNs),
+            Record.PlayerID,
+            JournalKindName(Record.Kind),
+            Record.Code >= 32 && Record.Code < 127 ? char(Record.Code) : '?',
+            Record.Size,
+            Record.LatencyUs);
+    }
+}
+
+static void PrintSummary(const std::vector<TJournalRecord>& Records) {
+    struct TTotals {
+        uint64_t Count { 0 };
+        uint64_t Bytes { 0 };
+        uint64_t LatencyUs { 0 };
+        uint32_t MaxLatencyUs { 0 };
+    };
+    std::map<std::tuple<TJournalKind, uint8_t>, TTotals> Totals;
+    for (const auto& Record : Records) {
+        auto& Entry = Totals[{ Record.Kind, Record.Code }];
+        ++Entry.Count;
+        Entry.Bytes += Record.Size;
+        Entry.LatencyUs += Record.LatencyUs;
+        Entry.MaxLatencyUs = std::max(Entry.MaxLatencyUs, Record.LatencyUs);
+    }
+    if (!Records.empty()) {
+        const double Seconds = double(Records.back().TimestampNs - Records.front().TimestampNs) / 1e9;
+        std::printf("%zu events over %.3fs\n", Records.size(), Seconds);
+    }
+    std::printf("%-10s %-4s %12s %14s %14s %14s\n", "kind", "code", "count", "bytes", "avg_lat_us", "max_lat_us");
+    for (const auto& [Key, Entry] : Totals) {
+        const auto& [Kind, Code] = Key;
+        std::printf("%-10s %-4c %12llu %14llu %14.1f %14u\n",
+            JournalKindName(Kind),
+            Code >= 32 && Code < 127 ? char(Code) : '?',
+            static_cast<unsigned long long>(Entry.Count),
+            static_cast<unsigned long long>(Entry.Bytes),
+            double(Entry.LatencyUs) / double(Entry.Count),
+            Entry.MaxLatencyUs);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3 || (argc == 3 && std::string_view(argv[2]) != "--summary")) {
+        std::fprintf(stderr, "Usage: %s <Server.journal> [--summary]\n", argv[0]);
+        return 1;
+    }
+    auto Records = ReadEventJournal(argv[1]);
+    if (!Records) {
+        std::fprintf(stderr, "'%s' is not a readable event journal\n", argv[1]);
+        return 1;
+    }
+    if (argc == 3) {
+        PrintSummary(*Records);
+    } else {
+        PrintCsv(*Records);
+    }
+    return 0;
+}